@@ -0,0 +1,112 @@
+// Microbenchmark of min-plus kernels: Floyd-Warshall over random route table
+// by every supported kernel, results are checked against the scalar kernel.
+// Usage: min_plus_benchmark [vertex_count]
+
+#include "min_plus.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace graph::min_plus;
+
+namespace {
+
+struct Table {
+    size_t vertex_count = 0;
+    vector<double> weights;
+    vector<PrevEdge> prev_edges;
+};
+
+// every edge is present with probability 1/4, self routes are empty
+Table MakeTable(size_t vertex_count) {
+    mt19937 generator(42);
+    uniform_real_distribution<double> weight(1, 100);
+    bernoulli_distribution has_edge(0.25);
+    Table table{vertex_count,
+                vector<double>(vertex_count * vertex_count, numeric_limits<double>::infinity()),
+                vector<PrevEdge>(vertex_count * vertex_count, NO_EDGE)};
+    PrevEdge edge_id = 0;
+    for (size_t from = 0; from < vertex_count; ++from) {
+        for (size_t to = 0; to < vertex_count; ++to) {
+            const size_t cell = from * vertex_count + to;
+            if (from == to) {
+                table.weights[cell] = 0;
+            } else if (has_edge(generator)) {
+                table.weights[cell] = weight(generator);
+                table.prev_edges[cell] = edge_id++;
+            }
+        }
+    }
+    return table;
+}
+
+// returns relaxed cells per second
+double FloydWarshall(RelaxRowFunc relax_row, Table& table) {
+    const size_t n = table.vertex_count;
+    const auto start = chrono::steady_clock::now();
+    for (size_t through = 0; through < n; ++through) {
+        for (size_t from = 0; from < n; ++from) {
+            const size_t cell_from = from * n + through;
+            if (table.weights[cell_from] == numeric_limits<double>::infinity()) {
+                continue;
+            }
+            relax_row(table.weights[cell_from], table.prev_edges[cell_from],
+                      &table.weights[through * n], &table.prev_edges[through * n],
+                      &table.weights[from * n], &table.prev_edges[from * n], n);
+        }
+    }
+    const chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+    return static_cast<double>(n) * n * n / seconds.count();
+}
+
+string_view KernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::SCALAR:
+            return "scalar";
+        case Kernel::SSE41:
+            return "sse4.1";
+        case Kernel::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t vertex_count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1024;
+    const Table initial = MakeTable(vertex_count);
+
+    Table expected = initial;
+    const double scalar_rate = FloydWarshall(GetRelaxRow(Kernel::SCALAR), expected);
+
+    cout << "vertices: " << vertex_count << ", best kernel: "
+         << KernelName(BestKernel()) << '\n';
+    bool ok = true;
+    for (const Kernel kernel : {Kernel::SCALAR, Kernel::SSE41, Kernel::AVX2}) {
+        if (!IsSupported(kernel)) {
+            cout << setw(8) << KernelName(kernel) << ": not supported\n";
+            continue;
+        }
+        Table table = initial;
+        const double rate = kernel == Kernel::SCALAR
+                                ? scalar_rate
+                                : FloydWarshall(GetRelaxRow(kernel), table);
+        const bool same = kernel == Kernel::SCALAR || (table.weights == expected.weights
+                                                       && table.prev_edges == expected.prev_edges);
+        ok = ok && same;
+        cout << setw(8) << KernelName(kernel) << ": " << fixed << setprecision(1)
+             << rate / 1e6 << " Mcells/s, x" << setprecision(2) << rate / scalar_rate
+             << (same ? "" : ", RESULT DIFFERS") << '\n';
+    }
+    return ok ? 0 : 1;
+}
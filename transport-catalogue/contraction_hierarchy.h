@@ -0,0 +1,577 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Contraction Hierarchies.
+// Preprocessing contracts vertices one by one, from less important to more important ones,
+// and adds shortcuts which keep shortest routes between remaining vertices. Query runs
+// bidirectional Dijkstra search which goes only upward in contraction order, then expands
+// shortcuts back to graph edges.
+//
+// Arcs are graph edges and shortcuts. Arc ids below graph.GetEdgeCount() are edge ids,
+// shortcut i has arc id graph.GetEdgeCount() + i.
+template <typename Weight, typename Index = VertexId>
+class ContractionHierarchy {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+    using RouteInfo = typename Router<Weight, Index>::RouteInfo;
+
+    explicit ContractionHierarchy(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // weights of routes from every source to every target without routes themselves,
+    // row-major sources.size() * targets.size() matrix, nullopt if there is no route.
+    // Upward searches from targets by reversed arcs leave (target, weight) in buckets of
+    // reached vertices, then upward search from every source scans buckets of its vertices.
+    std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+                                                    const std::vector<VertexId>& targets) const;
+
+    // internal types for (de)serialization
+    // shortcut replaces two consecutive arcs
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first_arc;
+        EdgeId second_arc;
+    };
+
+    struct HierarchyInternalData {
+        std::vector<size_t> ranks; // position of vertex in contraction order
+        std::vector<Shortcut> shortcuts;
+    };
+
+    // ctor with fields for deserialization
+    ContractionHierarchy(const Graph& graph, HierarchyInternalData&& data);
+
+    // internal data for serialization
+    const auto& InternalData() const { return data_; }
+
+private:
+    struct Arc {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+    };
+
+    // search state of one direction
+    struct Search {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_arcs;
+        std::priority_queue<std::pair<Weight, VertexId>, std::vector<std::pair<Weight, VertexId>>,
+                            std::greater<std::pair<Weight, VertexId>>> queue;
+    };
+
+    void InitializeArcs();
+    // weights of all vertices reached by upward search, backward search uses down arcs
+    void SearchUpward(VertexId source, bool is_forward, std::vector<Weight>& weights,
+                      std::vector<VertexId>& reached) const;
+    Arc GetArc(EdgeId arc_id) const;
+    void UnpackArc(EdgeId arc_id, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_ARC = std::numeric_limits<EdgeId>::max();
+
+    const Graph& graph_;
+    HierarchyInternalData data_;
+    std::vector<std::vector<EdgeId>> up_arcs_;   // arcs to vertices of higher rank
+    std::vector<std::vector<EdgeId>> down_arcs_; // arcs from vertices of higher rank
+};
+
+// Contraction of graph vertices. Order of contraction is chosen by edge difference
+// (shortcuts added minus arcs removed) plus number of already contracted neighbours,
+// priorities are updated lazily.
+template <typename Weight, typename Index = VertexId>
+class ContractionHierarchyBuilder {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+    using Hierarchy = ContractionHierarchy<Weight, Index>;
+    using Shortcut = typename Hierarchy::Shortcut;
+    using HierarchyInternalData = typename Hierarchy::HierarchyInternalData;
+
+    explicit ContractionHierarchyBuilder(const Graph& graph);
+
+    HierarchyInternalData Build();
+
+private:
+    struct Neighbour {
+        VertexId vertex;
+        EdgeId arc;
+    };
+    // the lightest arc for every neighbour, only not contracted neighbours
+    using Adjacency = std::vector<Neighbour>;
+
+    void AddArc(EdgeId arc_id, VertexId from, VertexId to);
+    static void SetNeighbour(Adjacency& adjacency, Neighbour neighbour,
+                             const std::vector<Weight>& arc_weights);
+    static void RemoveNeighbour(Adjacency& adjacency, VertexId vertex);
+    std::vector<Shortcut> FindShortcuts(VertexId vertex);
+    size_t EstimateShortcuts(VertexId vertex);
+    int64_t Priority(VertexId vertex, size_t shortcut_count) const;
+    void Contract(VertexId vertex, const std::vector<Shortcut>& shortcuts);
+    void RunWitnessSearch(VertexId source, VertexId excluded, Weight max_weight);
+
+    // witness search gives up after this number of settled vertices,
+    // shortcut is added then, it's always safe
+    static constexpr size_t WITNESS_SETTLED_LIMIT = 64;
+    // contraction of vertex with more in-out neighbour pairs isn't simulated,
+    // number of pairs is used as estimation of shortcuts
+    static constexpr size_t SIMULATION_PAIRS_LIMIT = 1000;
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+    const Graph& graph_;
+    std::vector<Weight> arc_weights_;   // graph edges then shortcuts
+    std::vector<Shortcut> shortcuts_;
+    std::vector<Adjacency> out_arcs_;
+    std::vector<Adjacency> in_arcs_;
+    std::vector<size_t> contracted_neighbours_;
+
+    // scratch arrays, all items are INFINITE_WEIGHT between calls
+    std::vector<Weight> direct_weights_;
+    std::vector<Weight> witness_weights_;
+    std::vector<VertexId> witness_touched_;
+};
+
+template <typename Weight, typename Index>
+ContractionHierarchyBuilder<Weight, Index>::ContractionHierarchyBuilder(const Graph& graph)
+    : graph_(graph)
+    , out_arcs_(graph.GetVertexCount())
+    , in_arcs_(graph.GetVertexCount())
+    , contracted_neighbours_(graph.GetVertexCount())
+    , direct_weights_(graph.GetVertexCount(), INFINITE_WEIGHT)
+    , witness_weights_(graph.GetVertexCount(), INFINITE_WEIGHT) {
+    arc_weights_.reserve(graph.GetEdgeCount());
+    for (const auto& edge : ranges::AsRange(graph.EdgesIterators())) {
+        if (edge.weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        arc_weights_.push_back(edge.weight);
+    }
+
+    // keep the lightest of parallel edges
+    std::vector<EdgeId> lightest_edges(graph.GetVertexCount());
+    std::vector<VertexId> neighbours;
+    for (VertexId from = 0; from < graph.GetVertexCount(); ++from) {
+        neighbours.clear();
+        for (const EdgeId edge_id : graph.GetIncidentEdges(from)) {
+            const VertexId to = graph.GetEdge(edge_id).to;
+            if (direct_weights_[to] == INFINITE_WEIGHT) {
+                neighbours.push_back(to);
+            }
+            if (arc_weights_[edge_id] < direct_weights_[to]) {
+                direct_weights_[to] = arc_weights_[edge_id];
+                lightest_edges[to] = edge_id;
+            }
+        }
+        for (const VertexId to : neighbours) {
+            direct_weights_[to] = INFINITE_WEIGHT;
+            if (to != from) { // loops never shorten routes
+                out_arcs_[from].push_back({to, lightest_edges[to]});
+                in_arcs_[to].push_back({from, lightest_edges[to]});
+            }
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchyBuilder<Weight, Index>::SetNeighbour(
+    Adjacency& adjacency, Neighbour neighbour, const std::vector<Weight>& arc_weights) {
+    auto it = std::find_if(adjacency.begin(), adjacency.end(), [&](const Neighbour& item) {
+        return item.vertex == neighbour.vertex;
+    });
+    if (it == adjacency.end()) {
+        adjacency.push_back(neighbour);
+    } else if (arc_weights[neighbour.arc] < arc_weights[it->arc]) {
+        it->arc = neighbour.arc;
+    }
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchyBuilder<Weight, Index>::RemoveNeighbour(Adjacency& adjacency,
+                                                                 VertexId vertex) {
+    auto it = std::find_if(adjacency.begin(), adjacency.end(), [&](const Neighbour& item) {
+        return item.vertex == vertex;
+    });
+    if (it != adjacency.end()) {
+        *it = adjacency.back();
+        adjacency.pop_back();
+    }
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchyBuilder<Weight, Index>::AddArc(EdgeId arc_id, VertexId from, VertexId to) {
+    SetNeighbour(out_arcs_[from], {to, arc_id}, arc_weights_);
+    SetNeighbour(in_arcs_[to], {from, arc_id}, arc_weights_);
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchyBuilder<Weight, Index>::RunWitnessSearch(VertexId source,
+                                                                  VertexId excluded,
+                                                                  Weight max_weight) {
+    for (const VertexId vertex : witness_touched_) {
+        witness_weights_[vertex] = INFINITE_WEIGHT;
+    }
+    witness_touched_.clear();
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    witness_weights_[source] = Weight{};
+    witness_touched_.push_back(source);
+    queue.push({Weight{}, source});
+    size_t settled = 0;
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > witness_weights_[vertex]) {
+            continue;
+        }
+        if (weight > max_weight || ++settled > WITNESS_SETTLED_LIMIT) {
+            break;
+        }
+        for (const auto& [to, arc_id] : out_arcs_[vertex]) {
+            if (to == excluded) {
+                continue;
+            }
+            const Weight candidate_weight = weight + arc_weights_[arc_id];
+            if (candidate_weight < witness_weights_[to] && candidate_weight <= max_weight) {
+                if (witness_weights_[to] == INFINITE_WEIGHT) {
+                    witness_touched_.push_back(to);
+                }
+                witness_weights_[to] = candidate_weight;
+                queue.push({candidate_weight, to});
+            }
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+std::vector<typename ContractionHierarchyBuilder<Weight, Index>::Shortcut>
+ContractionHierarchyBuilder<Weight, Index>::FindShortcuts(VertexId vertex) {
+    std::vector<Shortcut> shortcuts;
+    std::vector<Neighbour> targets;
+    for (const auto& [from, in_arc] : in_arcs_[vertex]) {
+        const Weight in_weight = arc_weights_[in_arc];
+
+        // targets which aren't reached by direct arc
+        for (const auto& [to, arc_id] : out_arcs_[from]) {
+            direct_weights_[to] = arc_weights_[arc_id];
+        }
+        targets.clear();
+        Weight max_weight{};
+        for (const auto& [to, out_arc] : out_arcs_[vertex]) {
+            const Weight weight = in_weight + arc_weights_[out_arc];
+            if (to != from && weight < direct_weights_[to]) {
+                targets.push_back({to, out_arc});
+                max_weight = std::max(max_weight, weight);
+            }
+        }
+        for (const auto& [to, arc_id] : out_arcs_[from]) {
+            direct_weights_[to] = INFINITE_WEIGHT;
+        }
+        if (targets.empty()) {
+            continue;
+        }
+
+        RunWitnessSearch(from, vertex, max_weight);
+        for (const auto& [to, out_arc] : targets) {
+            const Weight weight = in_weight + arc_weights_[out_arc];
+            if (witness_weights_[to] > weight) {
+                shortcuts.push_back({from, to, weight, in_arc, out_arc});
+            }
+        }
+    }
+    return shortcuts;
+}
+
+template <typename Weight, typename Index>
+size_t ContractionHierarchyBuilder<Weight, Index>::EstimateShortcuts(VertexId vertex) {
+    const size_t pairs = in_arcs_[vertex].size() * out_arcs_[vertex].size();
+    return pairs > SIMULATION_PAIRS_LIMIT ? pairs : FindShortcuts(vertex).size();
+}
+
+template <typename Weight, typename Index>
+int64_t ContractionHierarchyBuilder<Weight, Index>::Priority(VertexId vertex,
+                                                             size_t shortcut_count) const {
+    return static_cast<int64_t>(shortcut_count)
+         - static_cast<int64_t>(in_arcs_[vertex].size() + out_arcs_[vertex].size())
+         + static_cast<int64_t>(contracted_neighbours_[vertex]);
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchyBuilder<Weight, Index>::Contract(VertexId vertex,
+                                                          const std::vector<Shortcut>& shortcuts) {
+    for (const auto& [from, arc_id] : in_arcs_[vertex]) {
+        RemoveNeighbour(out_arcs_[from], vertex);
+        ++contracted_neighbours_[from];
+    }
+    for (const auto& [to, arc_id] : out_arcs_[vertex]) {
+        RemoveNeighbour(in_arcs_[to], vertex);
+        ++contracted_neighbours_[to];
+    }
+    in_arcs_[vertex].clear();
+    out_arcs_[vertex].clear();
+
+    for (const auto& shortcut : shortcuts) {
+        shortcuts_.push_back(shortcut);
+        arc_weights_.push_back(shortcut.weight);
+        AddArc(arc_weights_.size() - 1, shortcut.from, shortcut.to);
+    }
+}
+
+template <typename Weight, typename Index>
+typename ContractionHierarchyBuilder<Weight, Index>::HierarchyInternalData
+ContractionHierarchyBuilder<Weight, Index>::Build() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    using QueueItem = std::pair<int64_t, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.push({Priority(vertex, EstimateShortcuts(vertex)), vertex});
+    }
+
+    std::vector<size_t> ranks(vertex_count);
+    std::vector<bool> contracted(vertex_count, false);
+    size_t rank = 0;
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        if (contracted[vertex]) {
+            continue;
+        }
+        // lazy update: contract only if vertex is still the least important one
+        const int64_t priority = Priority(vertex, EstimateShortcuts(vertex));
+        if (!queue.empty() && priority > queue.top().first) {
+            queue.push({priority, vertex});
+            continue;
+        }
+        Contract(vertex, FindShortcuts(vertex));
+        contracted[vertex] = true;
+        ranks[vertex] = rank++;
+    }
+
+    return {std::move(ranks), std::move(shortcuts_)};
+}
+
+template <typename Weight, typename Index>
+ContractionHierarchy<Weight, Index>::ContractionHierarchy(const Graph& graph)
+    : graph_(graph)
+    , data_(ContractionHierarchyBuilder<Weight, Index>(graph).Build()) {
+    InitializeArcs();
+}
+
+template <typename Weight, typename Index>
+ContractionHierarchy<Weight, Index>::ContractionHierarchy(const Graph& graph,
+                                                          HierarchyInternalData&& data)
+    : graph_(graph)
+    , data_(std::move(data)) {
+    assert(data_.ranks.size() == graph.GetVertexCount());
+    InitializeArcs();
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchy<Weight, Index>::InitializeArcs() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    up_arcs_.assign(vertex_count, {});
+    down_arcs_.assign(vertex_count, {});
+    const size_t arc_count = graph_.GetEdgeCount() + data_.shortcuts.size();
+    for (EdgeId arc_id = 0; arc_id < arc_count; ++arc_id) {
+        const Arc arc = GetArc(arc_id);
+        if (data_.ranks[arc.from] < data_.ranks[arc.to]) {
+            up_arcs_[arc.from].push_back(arc_id);
+        } else if (data_.ranks[arc.from] > data_.ranks[arc.to]) {
+            down_arcs_[arc.to].push_back(arc_id);
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+typename ContractionHierarchy<Weight, Index>::Arc
+ContractionHierarchy<Weight, Index>::GetArc(EdgeId arc_id) const {
+    if (arc_id < graph_.GetEdgeCount()) {
+        const auto& edge = graph_.GetEdge(arc_id);
+        return {edge.from, edge.to, edge.weight};
+    }
+    const auto& shortcut = data_.shortcuts[arc_id - graph_.GetEdgeCount()];
+    return {shortcut.from, shortcut.to, shortcut.weight};
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchy<Weight, Index>::UnpackArc(EdgeId arc_id,
+                                                   std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack{arc_id};
+    while (!stack.empty()) {
+        const EdgeId id = stack.back();
+        stack.pop_back();
+        if (id < graph_.GetEdgeCount()) {
+            edges.push_back(id);
+        } else {
+            const auto& shortcut = data_.shortcuts[id - graph_.GetEdgeCount()];
+            stack.push_back(shortcut.second_arc);
+            stack.push_back(shortcut.first_arc);
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+std::optional<typename ContractionHierarchy<Weight, Index>::RouteInfo>
+ContractionHierarchy<Weight, Index>::BuildRoute(VertexId from, VertexId to) const {
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    Search forward{std::vector<Weight>(vertex_count, INFINITE_WEIGHT),
+                   std::vector<EdgeId>(vertex_count, NO_ARC), {}};
+    Search backward{forward};
+    forward.weights[from] = ZERO_WEIGHT;
+    forward.queue.push({ZERO_WEIGHT, from});
+    backward.weights[to] = ZERO_WEIGHT;
+    backward.queue.push({ZERO_WEIGHT, to});
+
+    Weight best_weight = INFINITE_WEIGHT;
+    VertexId meeting_vertex = from;
+
+    auto top_weight = [](const Search& search) {
+        return search.queue.empty() ? INFINITE_WEIGHT : search.queue.top().first;
+    };
+
+    while (std::min(top_weight(forward), top_weight(backward)) < best_weight) {
+        const bool is_forward = top_weight(forward) <= top_weight(backward);
+        Search& search = is_forward ? forward : backward;
+        const Search& other = is_forward ? backward : forward;
+
+        const auto [weight, vertex] = search.queue.top();
+        search.queue.pop();
+        if (weight > search.weights[vertex]) {
+            continue;
+        }
+        if (other.weights[vertex] != INFINITE_WEIGHT
+            && weight + other.weights[vertex] < best_weight) {
+            best_weight = weight + other.weights[vertex];
+            meeting_vertex = vertex;
+        }
+
+        for (const EdgeId arc_id : is_forward ? up_arcs_[vertex] : down_arcs_[vertex]) {
+            const Arc arc = GetArc(arc_id);
+            const VertexId next = is_forward ? arc.to : arc.from;
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < search.weights[next]) {
+                search.weights[next] = candidate_weight;
+                search.prev_arcs[next] = arc_id;
+                search.queue.push({candidate_weight, next});
+            }
+        }
+    }
+
+    if (best_weight == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    // arcs from 'from' to meeting vertex, then from meeting vertex to 'to'
+    std::vector<EdgeId> arcs;
+    for (EdgeId arc_id = forward.prev_arcs[meeting_vertex];
+         arc_id != NO_ARC;
+         arc_id = forward.prev_arcs[GetArc(arc_id).from]) {
+        arcs.push_back(arc_id);
+    }
+    std::reverse(arcs.begin(), arcs.end());
+    for (EdgeId arc_id = backward.prev_arcs[meeting_vertex];
+         arc_id != NO_ARC;
+         arc_id = backward.prev_arcs[GetArc(arc_id).to]) {
+        arcs.push_back(arc_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId arc_id : arcs) {
+        UnpackArc(arc_id, edges);
+    }
+    return RouteInfo{best_weight, std::move(edges)};
+}
+
+template <typename Weight, typename Index>
+void ContractionHierarchy<Weight, Index>::SearchUpward(VertexId source, bool is_forward,
+                                                       std::vector<Weight>& weights,
+                                                       std::vector<VertexId>& reached) const {
+    for (const VertexId vertex : reached) {
+        weights[vertex] = INFINITE_WEIGHT;
+    }
+    reached.clear();
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    weights[source] = ZERO_WEIGHT;
+    reached.push_back(source);
+    queue.push({ZERO_WEIGHT, source});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue;
+        }
+        for (const EdgeId arc_id : is_forward ? up_arcs_[vertex] : down_arcs_[vertex]) {
+            const Arc arc = GetArc(arc_id);
+            const VertexId next = is_forward ? arc.to : arc.from;
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < weights[next]) {
+                if (weights[next] == INFINITE_WEIGHT) {
+                    reached.push_back(next);
+                }
+                weights[next] = candidate_weight;
+                queue.push({candidate_weight, next});
+            }
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+std::vector<std::optional<Weight>>
+ContractionHierarchy<Weight, Index>::BuildWeights(const std::vector<VertexId>& sources,
+                                                  const std::vector<VertexId>& targets) const {
+    struct BucketItem {
+        size_t target_index;
+        Weight weight;
+    };
+    std::vector<std::vector<BucketItem>> buckets(graph_.GetVertexCount());
+    std::vector<Weight> weights(graph_.GetVertexCount(), INFINITE_WEIGHT);
+    std::vector<VertexId> reached;
+    for (size_t target_index = 0; target_index < targets.size(); ++target_index) {
+        SearchUpward(targets[target_index], false, weights, reached);
+        for (const VertexId vertex : reached) {
+            buckets[vertex].push_back({target_index, weights[vertex]});
+        }
+    }
+
+    std::vector<std::optional<Weight>> result(sources.size() * targets.size());
+    for (size_t source_index = 0; source_index < sources.size(); ++source_index) {
+        SearchUpward(sources[source_index], true, weights, reached);
+        std::optional<Weight>* row = &result[source_index * targets.size()];
+        for (const VertexId vertex : reached) {
+            for (const auto& [target_index, weight] : buckets[vertex]) {
+                const Weight candidate_weight = weights[vertex] + weight;
+                if (!row[target_index] || candidate_weight < *row[target_index]) {
+                    row[target_index] = candidate_weight;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+}  // namespace graph
@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Datasets of s14_3_test.sh are built again with other routing settings. Routes may differ
+# in ties, so only total times and errors are compared with the answers.
+
+times='"(total_time|error_message)"'
+
+# check <dataset> <settings added to routing_settings>
+check() {
+    echo "$1, $2"
+
+    sed "s/\"bus_velocity\": \([0-9]*\)/\"bus_velocity\": \1, $2/" s14_3_$1_make_base.json | \
+        ../build/transport_catalogue.exe make_base
+    diff -u <(cat s14_3_$1_answer.json | python -m json.tool | grep -E "$times") \
+            <(../build/transport_catalogue.exe process_requests s14_3_$1_process_requests.json | \
+                  grep -E "$times")
+}
+
+for dataset in example_1 example_2 opentest_1 opentest_2 opentest_3; do
+    check $dataset '"router": "dijkstra"'
+    check $dataset '"router": "all_pairs"'
+    check $dataset '"router": "contraction_hierarchies"'
+    check $dataset '"graph_model": "wait_and_ride"'
+    check $dataset '"graph_model": "wait_and_ride", "router": "contraction_hierarchies"'
+    check $dataset '"router": "astar"'
+    check $dataset '"graph_model": "wait_and_ride", "router": "astar"'
+    check $dataset '"router": "alt"'
+    check $dataset '"graph_model": "wait_and_ride", "router": "alt"'
+    check $dataset '"router": "bidirectional_dijkstra"'
+    check $dataset '"graph_model": "wait_and_ride", "router": "bidirectional_dijkstra"'
+    check $dataset '"router": "raptor"'
+    check $dataset '"route_cache_size": 3'
+    check $dataset '"router": "dijkstra", "route_cache_size": 16'
+    check $dataset '"router": "hub_labels"'
+    check $dataset '"graph_model": "wait_and_ride", "router": "hub_labels"'
+    check $dataset '"vertex_order": "hilbert"'
+    check $dataset '"router": "dijkstra", "vertex_order": "hilbert"'
+    check $dataset \
+        '"graph_model": "wait_and_ride", "router": "contraction_hierarchies", "vertex_order": "hilbert"'
+    # delta-stepping one-to-all searches, alight edges of wait_and_ride graphs weigh zero
+    check $dataset '"router": "dijkstra", "parallel_search_min_vertices": 0'
+    check $dataset '"graph_model": "wait_and_ride", "parallel_search_min_vertices": 0'
+done
+
+# all_pairs tables of wait_and_ride graphs have rows of ride vertices too,
+# the table of opentest 3 (about 23.6k vertices) doesn't fit in memory
+for dataset in example_1 example_2 opentest_1 opentest_2; do
+    check $dataset '"graph_model": "wait_and_ride", "router": "all_pairs"'
+done
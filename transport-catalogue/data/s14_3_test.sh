@@ -32,3 +32,64 @@ echo "opentest 3"
 ../build/transport_catalogue.exe process_requests s14_3_opentest_3_process_requests.json > s14_3_opentest_3_output.json
 
 cat s14_3_opentest_3_answer.json | python -m json.tool | diff -uw - s14_3_opentest_3_output.json
+
+echo "matrix"
+
+../build/transport_catalogue.exe make_base s14_3_matrix_make_base.json
+../build/transport_catalogue.exe process_requests s14_3_matrix_process_requests.json > s14_3_matrix_output.json
+
+cat s14_3_matrix_answer.json | python -m json.tool | diff -uw - s14_3_matrix_output.json
+
+# the same times by other routers, minutes are whole so sums are exact
+for settings in '"router": "dijkstra"' '"router": "contraction_hierarchies"' \
+                '"router": "hub_labels"' '"graph_model": "wait_and_ride", "router": "dijkstra"'; do
+    echo "matrix, $settings"
+
+    sed "s/\"bus_velocity\": 30/\"bus_velocity\": 30, $settings/" s14_3_matrix_make_base.json | \
+        ../build/transport_catalogue.exe make_base
+    ../build/transport_catalogue.exe process_requests s14_3_matrix_process_requests.json > s14_3_matrix_output.json
+
+    cat s14_3_matrix_answer.json | python -m json.tool | diff -uw - s14_3_matrix_output.json
+done
+
+echo "isochrone"
+
+../build/transport_catalogue.exe make_base s14_3_isochrone_make_base.json
+../build/transport_catalogue.exe process_requests s14_3_isochrone_process_requests.json > s14_3_isochrone_output.json
+
+cat s14_3_isochrone_answer.json | python -m json.tool | diff -uw - s14_3_isochrone_output.json
+
+# wait_and_ride graphs have ride vertices which must not get into the answer
+for settings in '"router": "dijkstra"' '"graph_model": "wait_and_ride", "router": "dijkstra"' \
+                '"graph_model": "wait_and_ride", "router": "all_pairs"' \
+                '"graph_model": "wait_and_ride", "parallel_search_min_vertices": 0'; do
+    echo "isochrone, $settings"
+
+    sed "s/\"bus_velocity\": 30/\"bus_velocity\": 30, $settings/" s14_3_isochrone_make_base.json | \
+        ../build/transport_catalogue.exe make_base
+    ../build/transport_catalogue.exe process_requests s14_3_isochrone_process_requests.json > s14_3_isochrone_output.json
+
+    cat s14_3_isochrone_answer.json | python -m json.tool | diff -uw - s14_3_isochrone_output.json
+done
+
+echo "opentest 2, update"
+
+# base without the last bus and stops which only it uses, update_base adds them
+../build/transport_catalogue.exe make_base s14_3_opentest_2_update_make_base.json
+../build/transport_catalogue.exe update_base s14_3_opentest_2_update_update_base.json
+../build/transport_catalogue.exe process_requests s14_3_opentest_2_process_requests.json > s14_3_opentest_2_update_output.json
+
+cat s14_3_opentest_2_answer.json | python -m json.tool | diff -uw - s14_3_opentest_2_update_output.json
+
+# new stops of wait_and_ride graph get vertices after ride vertices of old buses
+for settings in '"router": "contraction_hierarchies"' '"router": "hub_labels"' \
+                '"graph_model": "wait_and_ride", "router": "alt"'; do
+    echo "opentest 2, update, $settings"
+
+    sed "s/\"bus_velocity\": 222/\"bus_velocity\": 222, $settings/" s14_3_opentest_2_update_make_base.json | \
+        ../build/transport_catalogue.exe make_base
+    ../build/transport_catalogue.exe update_base s14_3_opentest_2_update_update_base.json
+    ../build/transport_catalogue.exe process_requests s14_3_opentest_2_process_requests.json > s14_3_opentest_2_update_output.json
+
+    cat s14_3_opentest_2_answer.json | python -m json.tool | diff -uw - s14_3_opentest_2_update_output.json
+done
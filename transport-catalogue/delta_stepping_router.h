@@ -0,0 +1,224 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// One-to-all searches by parallel delta-stepping for large graphs.
+// Vertices are kept in buckets of width delta by tentative route weight. Buckets are
+// processed in order: light edges (not heavier than delta) of the current bucket are relaxed
+// repeatedly until the bucket is empty, then heavy edges of all vertices removed from it.
+// Edges of a bucket are scanned in parallel, relaxations are applied by the caller thread
+// in order of vertices, so results don't depend on the number of threads.
+//
+// Route weights are the same as Dijkstra ones. Every vertex keeps the edge of the relaxation
+// which set its final weight, so routes are shortest ones, but of equally heavy routes
+// they may differ from DijkstraRouter ones.
+template <typename Weight, typename Index = VertexId>
+class DeltaSteppingRouter {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+    using RouteInfo = typename Router<Weight, Index>::RouteInfo;
+
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    // edges are scanned by threads of thread_pool,
+    // delta is the average edge weight if it isn't positive
+    DeltaSteppingRouter(const Graph& graph, parallel::ThreadPool& thread_pool,
+                        Weight delta = Weight{});
+
+    // route weights (INFINITE_WEIGHT if there is no route or it is heavier than max_weight)
+    // and last edges of routes from the source to every vertex
+    struct Tree {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+    };
+    Tree BuildTree(VertexId from, Weight max_weight = INFINITE_WEIGHT) const;
+
+    // routes from the source to every target, nullopt if there is no route
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const;
+
+    // vertices reachable from vertex by routes not heavier than max_weight with route weights
+    // in order of weight
+    std::vector<std::pair<VertexId, Weight>> BuildReachable(VertexId from,
+                                                            Weight max_weight) const;
+
+private:
+    struct Relaxation {
+        VertexId vertex;
+        Weight weight;
+        EdgeId edge;
+    };
+
+    // Relaxations by light or heavy edges of vertices are found in parallel, then applied
+    // in order. Applied relaxation sets the last edge of the route too: weight of its
+    // source was final before the weight of its target, so last edges never form cycles
+    // even through zero weight edges.
+    void Relax(const std::vector<VertexId>& vertices, bool light, Weight max_weight,
+               Tree& tree, std::vector<std::vector<VertexId>>& buckets) const;
+
+    size_t BucketIndex(Weight weight) const {
+        return static_cast<size_t>(weight / delta_);
+    }
+
+    // vertices of one parallel task
+    static constexpr size_t CHUNK_SIZE = 256;
+    static constexpr Weight ZERO_WEIGHT{};
+
+    const Graph& graph_;
+    parallel::ThreadPool& thread_pool_;
+    Weight delta_;
+};
+
+template <typename Weight, typename Index>
+DeltaSteppingRouter<Weight, Index>::DeltaSteppingRouter(const Graph& graph,
+                                                        parallel::ThreadPool& thread_pool,
+                                                        Weight delta)
+    : graph_(graph), thread_pool_(thread_pool), delta_(delta) {
+    Weight weight_sum = ZERO_WEIGHT;
+    for (const auto& edge : ranges::AsRange(graph.EdgesIterators())) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        weight_sum += edge.weight;
+    }
+    if (!(delta_ > ZERO_WEIGHT)) {
+        delta_ = graph.GetEdgeCount() > 0 ? weight_sum / graph.GetEdgeCount() : Weight{1};
+    }
+    if (!(delta_ > ZERO_WEIGHT)) {
+        delta_ = Weight{1};
+    }
+}
+
+template <typename Weight, typename Index>
+typename DeltaSteppingRouter<Weight, Index>::Tree
+DeltaSteppingRouter<Weight, Index>::BuildTree(VertexId from, Weight max_weight) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    Tree tree{std::vector<Weight>(vertex_count, INFINITE_WEIGHT),
+              std::vector<EdgeId>(vertex_count, NO_EDGE)};
+    // weight of vertex when its light edges were relaxed last time
+    std::vector<Weight> relaxed_weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<bool> is_removed(vertex_count, false);
+    std::vector<std::vector<VertexId>> buckets(1);
+
+    tree.weights[from] = ZERO_WEIGHT;
+    buckets[0].push_back(from);
+    std::vector<VertexId> frontier;
+    std::vector<VertexId> removed;
+    for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+        removed.clear();
+        while (!buckets[bucket].empty()) {
+            // vertices may be in the bucket several times or already moved to lighter ones
+            frontier.clear();
+            for (const VertexId vertex : buckets[bucket]) {
+                const Weight weight = tree.weights[vertex];
+                if (BucketIndex(weight) == bucket && weight < relaxed_weights[vertex]) {
+                    relaxed_weights[vertex] = weight;
+                    frontier.push_back(vertex);
+                    if (!is_removed[vertex]) {
+                        is_removed[vertex] = true;
+                        removed.push_back(vertex);
+                    }
+                }
+            }
+            buckets[bucket].clear();
+            Relax(frontier, true, max_weight, tree, buckets);
+        }
+        Relax(removed, false, max_weight, tree, buckets);
+    }
+
+    return tree;
+}
+
+template <typename Weight, typename Index>
+void DeltaSteppingRouter<Weight, Index>::Relax(const std::vector<VertexId>& vertices, bool light,
+                                               Weight max_weight, Tree& tree,
+                                               std::vector<std::vector<VertexId>>& buckets) const {
+    const size_t chunk_count = (vertices.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<std::vector<Relaxation>> relaxations(chunk_count);
+    thread_pool_.ParallelFor(chunk_count, [&](size_t chunk) {
+        const size_t end = std::min(vertices.size(), (chunk + 1) * CHUNK_SIZE);
+        for (size_t index = chunk * CHUNK_SIZE; index < end; ++index) {
+            const VertexId vertex = vertices[index];
+            const Weight weight = tree.weights[vertex];
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                if ((edge.weight <= delta_) != light) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < tree.weights[edge.to] && candidate_weight <= max_weight) {
+                    relaxations[chunk].push_back({edge.to, candidate_weight, edge_id});
+                }
+            }
+        }
+    });
+
+    for (const auto& chunk_relaxations : relaxations) {
+        for (const auto& [vertex, weight, edge_id] : chunk_relaxations) {
+            if (weight < tree.weights[vertex]) {
+                tree.weights[vertex] = weight;
+                tree.prev_edges[vertex] = edge_id;
+                const size_t bucket = BucketIndex(weight);
+                if (bucket >= buckets.size()) {
+                    buckets.resize(bucket + 1);
+                }
+                buckets[bucket].push_back(vertex);
+            }
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+std::vector<std::optional<typename DeltaSteppingRouter<Weight, Index>::RouteInfo>>
+DeltaSteppingRouter<Weight, Index>::BuildRoutes(VertexId from,
+                                                const std::vector<VertexId>& targets) const {
+    const Tree tree = BuildTree(from);
+    std::vector<std::optional<RouteInfo>> result;
+    result.reserve(targets.size());
+    for (const VertexId to : targets) {
+        if (tree.weights[to] == INFINITE_WEIGHT) {
+            result.emplace_back();
+            continue;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = tree.prev_edges[to];
+             edge_id != NO_EDGE;
+             edge_id = tree.prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        result.push_back(RouteInfo{tree.weights[to], std::move(edges)});
+    }
+    return result;
+}
+
+template <typename Weight, typename Index>
+std::vector<std::pair<VertexId, Weight>>
+DeltaSteppingRouter<Weight, Index>::BuildReachable(VertexId from, Weight max_weight) const {
+    const Tree tree = BuildTree(from, max_weight);
+    std::vector<std::pair<VertexId, Weight>> result;
+    for (VertexId vertex = 0; vertex < tree.weights.size(); ++vertex) {
+        if (tree.weights[vertex] != INFINITE_WEIGHT) {
+            result.push_back({vertex, tree.weights[vertex]});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.second, lhs.first) < std::tie(rhs.second, rhs.first);
+    });
+    return result;
+}
+
+}  // namespace graph
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Router without precomputed data. Every query runs Dijkstra search with binary heap
+// and stops as soon as target vertex is settled.
+// A* query takes potential: lower bound of the route weight from the vertex to the target.
+// Potential must be consistent: potential(u) <= weight(u, v) + potential(v) for every edge.
+// Vertices with INFINITE_WEIGHT potential can't reach the target and are not visited.
+// Bidirectional query searches forward from the source and backward from the target
+// by incoming edges and stops when the sum of both frontiers reaches the best found route.
+template <typename Weight, typename Index = VertexId>
+class DijkstraRouter {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+    using RouteInfo = typename Router<Weight, Index>::RouteInfo;
+
+    // BuildWeights searches by threads of thread_pool
+    DijkstraRouter(const Graph& graph, parallel::ThreadPool& thread_pool);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // A* search, potential is called as potential(vertex) -> Weight
+    template <typename Potential>
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to,
+                                        const Potential& potential) const;
+
+    std::optional<RouteInfo> BuildRouteBidirectional(VertexId from, VertexId to) const;
+
+    // routes from one source to every target by one search which stops when all targets
+    // are settled, routes are the same as BuildRoute ones
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const;
+
+    // weights of routes from every source to every target without routes themselves,
+    // row-major sources.size() * targets.size() matrix, nullopt if there is no route.
+    // One search per source stops when all targets are settled, sources are searched in parallel.
+    std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+                                                    const std::vector<VertexId>& targets) const;
+
+    // vertices reachable from vertex by routes not heavier than max_weight with route weights
+    // in order of weight, search stops at max_weight
+    std::vector<std::pair<VertexId, Weight>> BuildReachable(VertexId from,
+                                                            Weight max_weight) const;
+
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    // priority queue item: (weight + potential, weight, vertex)
+    using QueueItem = std::tuple<Weight, Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    const Graph& graph_;
+    parallel::ThreadPool& thread_pool_;
+};
+
+template <typename Weight, typename Index>
+DijkstraRouter<Weight, Index>::DijkstraRouter(const Graph& graph,
+                                              parallel::ThreadPool& thread_pool)
+    : graph_(graph), thread_pool_(thread_pool) {
+    for (const auto& edge : ranges::AsRange(graph.EdgesIterators())) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+std::optional<typename DijkstraRouter<Weight, Index>::RouteInfo>
+DijkstraRouter<Weight, Index>::BuildRoute(VertexId from, VertexId to) const {
+    return BuildRoute(from, to, [](VertexId) { return ZERO_WEIGHT; });
+}
+
+template <typename Weight, typename Index>
+template <typename Potential>
+std::optional<typename DijkstraRouter<Weight, Index>::RouteInfo>
+DijkstraRouter<Weight, Index>::BuildRoute(VertexId from, VertexId to,
+                                          const Potential& potential) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+
+    const Weight from_potential = potential(from);
+    if (from_potential == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    Queue queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({from_potential, ZERO_WEIGHT, from});
+    while (!queue.empty()) {
+        const auto [key, weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue; // outdated item
+        }
+        if (vertex == to) {
+            break;
+        }
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < weights[edge.to]) {
+                const Weight to_potential = potential(edge.to);
+                if (to_potential == INFINITE_WEIGHT) {
+                    continue;
+                }
+                weights[edge.to] = candidate_weight;
+                prev_edges[edge.to] = edge_id;
+                queue.push({candidate_weight + to_potential, candidate_weight, edge.to});
+            }
+        }
+    }
+
+    if (weights[to] == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = prev_edges[to];
+         edge_id != NO_EDGE;
+         edge_id = prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weights[to], std::move(edges)};
+}
+
+template <typename Weight, typename Index>
+std::vector<std::optional<typename DijkstraRouter<Weight, Index>::RouteInfo>>
+DijkstraRouter<Weight, Index>::BuildRoutes(VertexId from,
+                                           const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<bool> is_target(vertex_count, false);
+    size_t target_count = 0;
+    for (const VertexId target : targets) {
+        if (!is_target[target]) {
+            is_target[target] = true;
+            ++target_count;
+        }
+    }
+
+    std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+    Queue queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, ZERO_WEIGHT, from});
+    size_t settled_targets = 0;
+    while (!queue.empty()) {
+        const auto [key, weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue; // outdated item
+        }
+        if (is_target[vertex] && ++settled_targets == target_count) {
+            break;
+        }
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < weights[edge.to]) {
+                weights[edge.to] = candidate_weight;
+                prev_edges[edge.to] = edge_id;
+                queue.push({candidate_weight, candidate_weight, edge.to});
+            }
+        }
+    }
+
+    std::vector<std::optional<RouteInfo>> result;
+    result.reserve(targets.size());
+    for (const VertexId to : targets) {
+        if (weights[to] == INFINITE_WEIGHT) {
+            result.emplace_back();
+            continue;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = prev_edges[to];
+             edge_id != NO_EDGE;
+             edge_id = prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        result.push_back(RouteInfo{weights[to], std::move(edges)});
+    }
+    return result;
+}
+
+template <typename Weight, typename Index>
+std::vector<std::optional<Weight>>
+DijkstraRouter<Weight, Index>::BuildWeights(const std::vector<VertexId>& sources,
+                                            const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<bool> is_target(vertex_count, false);
+    size_t target_count = 0;
+    for (const VertexId target : targets) {
+        if (!is_target[target]) {
+            is_target[target] = true;
+            ++target_count;
+        }
+    }
+
+    std::vector<std::optional<Weight>> result(sources.size() * targets.size());
+    thread_pool_.ParallelFor(sources.size(), [&](size_t source_index) {
+        std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+        using Item = std::pair<Weight, VertexId>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+        const VertexId from = sources[source_index];
+        weights[from] = ZERO_WEIGHT;
+        queue.push({ZERO_WEIGHT, from});
+        size_t settled_targets = 0;
+        while (!queue.empty() && settled_targets < target_count) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) {
+                continue; // outdated item
+            }
+            if (is_target[vertex]) {
+                ++settled_targets;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < weights[edge.to]) {
+                    weights[edge.to] = candidate_weight;
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+        for (size_t target_index = 0; target_index < targets.size(); ++target_index) {
+            const Weight weight = weights[targets[target_index]];
+            if (weight != INFINITE_WEIGHT) {
+                result[source_index * targets.size() + target_index] = weight;
+            }
+        }
+    });
+    return result;
+}
+
+template <typename Weight, typename Index>
+std::vector<std::pair<VertexId, Weight>>
+DijkstraRouter<Weight, Index>::BuildReachable(VertexId from, Weight max_weight) const {
+    std::vector<std::pair<VertexId, Weight>> result;
+    std::vector<Weight> weights(graph_.GetVertexCount(), INFINITE_WEIGHT);
+    using Item = std::pair<Weight, VertexId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, from});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue; // outdated item
+        }
+        result.push_back({vertex, weight});
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < weights[edge.to] && candidate_weight <= max_weight) {
+                weights[edge.to] = candidate_weight;
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+    return result;
+}
+
+template <typename Weight, typename Index>
+std::optional<typename DijkstraRouter<Weight, Index>::RouteInfo>
+DijkstraRouter<Weight, Index>::BuildRouteBidirectional(VertexId from, VertexId to) const {
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    // search state of one direction, prev_edges of backward search lead to the target
+    struct Search {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::priority_queue<std::pair<Weight, VertexId>, std::vector<std::pair<Weight, VertexId>>,
+                            std::greater<std::pair<Weight, VertexId>>> queue;
+    };
+    const size_t vertex_count = graph_.GetVertexCount();
+    Search forward{std::vector<Weight>(vertex_count, INFINITE_WEIGHT),
+                   std::vector<EdgeId>(vertex_count, NO_EDGE), {}};
+    Search backward{forward.weights, forward.prev_edges, {}};
+    forward.weights[from] = ZERO_WEIGHT;
+    forward.queue.push({ZERO_WEIGHT, from});
+    backward.weights[to] = ZERO_WEIGHT;
+    backward.queue.push({ZERO_WEIGHT, to});
+
+    Weight best_weight = INFINITE_WEIGHT;
+    VertexId meeting_vertex = from;
+
+    const auto top_weight = [](const Search& search) {
+        return search.queue.empty() ? INFINITE_WEIGHT : search.queue.top().first;
+    };
+    // settle one vertex of search, other is the search in opposite direction
+    const auto step = [&](Search& search, const Search& other, bool is_forward) {
+        const auto [weight, vertex] = search.queue.top();
+        search.queue.pop();
+        if (weight > search.weights[vertex]) {
+            return; // outdated item
+        }
+        const auto edges = is_forward ? graph_.GetIncidentEdges(vertex)
+                                      : graph_.GetIncomingEdges(vertex);
+        for (const EdgeId edge_id : edges) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const VertexId next = is_forward ? edge.to : edge.from;
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < search.weights[next]) {
+                search.weights[next] = candidate_weight;
+                search.prev_edges[next] = edge_id;
+                search.queue.push({candidate_weight, next});
+                if (other.weights[next] != INFINITE_WEIGHT
+                    && candidate_weight + other.weights[next] < best_weight) {
+                    best_weight = candidate_weight + other.weights[next];
+                    meeting_vertex = next;
+                }
+            }
+        }
+    };
+
+    while (!forward.queue.empty() && !backward.queue.empty()) {
+        const Weight forward_top = top_weight(forward);
+        const Weight backward_top = top_weight(backward);
+        if (best_weight != INFINITE_WEIGHT && forward_top + backward_top >= best_weight) {
+            break;
+        }
+        if (forward_top <= backward_top) {
+            step(forward, backward, true);
+        } else {
+            step(backward, forward, false);
+        }
+    }
+
+    if (best_weight == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = forward.prev_edges[meeting_vertex];
+         edge_id != NO_EDGE;
+         edge_id = forward.prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (EdgeId edge_id = backward.prev_edges[meeting_vertex];
+         edge_id != NO_EDGE;
+         edge_id = backward.prev_edges[graph_.GetEdge(edge_id).to])
+    {
+        edges.push_back(edge_id);
+    }
+
+    return RouteInfo{best_weight, std::move(edges)};
+}
+
+}  // namespace graph
@@ -2,7 +2,11 @@
 
 #include "ranges.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -10,72 +14,232 @@ namespace graph {
 using VertexId = size_t;
 using EdgeId = size_t;
 
-template <typename Weight>
+// Index is the type of vertex and edge ids stored in the graph, it may be narrower than
+// VertexId and EdgeId of the interface to save memory of edges and incidence lists
+template <typename Weight, typename Index = VertexId>
 struct Edge {
-    VertexId from;
-    VertexId to;
+    Index from;
+    Index to;
     Weight weight;
 };
 
-template <typename Weight>
+template <typename Weight, typename Index = VertexId>
 class DirectedWeightedGraph {
 private:
-    using IncidenceList = std::vector<EdgeId>;
+    using IncidenceList = std::vector<Index>;
     using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
-    EdgeId AddEdge(const Edge<Weight>& edge);
+    // frozen graph of all edges at once, edge ids are indices in edges
+    DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight, Index>>&& edges);
+    EdgeId AddEdge(const Edge<Weight, Index>& edge);
+    // throws std::length_error if vertex ids don't fit Index
+    EdgeId AddEdge(VertexId from, VertexId to, Weight weight);
+    // vertex without edges
+    VertexId AddVertex();
+
+    // Packs incidence lists into contiguous arrays (compressed sparse row) when the graph
+    // is built, so scans of incident edges don't jump between heap blocks. Edges and
+    // vertices can't be added to a frozen graph (std::logic_error) until it is thawed.
+    // Ids and order of incident edges don't change.
+    void Freeze();
+    void Thaw();
+    bool IsFrozen() const;
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
-    const Edge<Weight>& GetEdge(EdgeId edge_id) const;
+    const Edge<Weight, Index>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    // edges which go to the vertex
+    IncidentEdgesRange GetIncomingEdges(VertexId vertex) const;
 
     auto EdgesIterators() const {
         return std::make_pair(edges_.cbegin(), edges_.cend());
     }
 
 private:
-    std::vector<Edge<Weight>> edges_;
+    // incidence lists of all vertices one after another,
+    // list of vertex v is edge_ids[offsets[v] .. offsets[v + 1])
+    struct PackedLists {
+        std::vector<size_t> offsets;
+        IncidenceList edge_ids;
+    };
+
+    static void CheckIndex(size_t id) {
+        if (id > std::numeric_limits<Index>::max()) {
+            throw std::length_error("Too many vertices or edges for graph index type");
+        }
+    }
+
+    void CheckNotFrozen() const {
+        if (frozen_) {
+            throw std::logic_error("Graph is frozen");
+        }
+    }
+
+    // lists of edges by their ends (Edge::from or Edge::to) in order of edge ids
+    static PackedLists Pack(size_t vertex_count, const std::vector<Edge<Weight, Index>>& edges,
+                            Index Edge<Weight, Index>::*end);
+
+    static IncidentEdgesRange GetList(const PackedLists& lists, VertexId vertex) {
+        return IncidentEdgesRange(lists.edge_ids.cbegin() + lists.offsets[vertex],
+                                  lists.edge_ids.cbegin() + lists.offsets[vertex + 1]);
+    }
+
+    std::vector<Edge<Weight, Index>> edges_;
     std::vector<IncidenceList> incidence_lists_;
+    std::vector<IncidenceList> incoming_lists_;
+    bool frozen_ = false;
+    PackedLists packed_incidence_lists_;
+    PackedLists packed_incoming_lists_;
 };
 
-template <typename Weight>
-DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+template <typename Weight, typename Index>
+DirectedWeightedGraph<Weight, Index>::DirectedWeightedGraph(size_t vertex_count)
+    : incidence_lists_(vertex_count), incoming_lists_(vertex_count) {
+    if (vertex_count > 0) {
+        CheckIndex(vertex_count - 1);
+    }
+}
+
+template <typename Weight, typename Index>
+DirectedWeightedGraph<Weight, Index>::DirectedWeightedGraph(
+    size_t vertex_count, std::vector<Edge<Weight, Index>>&& edges)
+    : edges_(std::move(edges)) {
+    if (!edges_.empty()) {
+        CheckIndex(edges_.size() - 1);
+    }
+    for (const auto& edge : edges_) {
+        vertex_count = std::max<size_t>({vertex_count, edge.from + size_t{1}, edge.to + size_t{1}});
+    }
+    if (vertex_count > 0) {
+        CheckIndex(vertex_count - 1);
+    }
+    frozen_ = true;
+    packed_incidence_lists_ = Pack(vertex_count, edges_, &Edge<Weight, Index>::from);
+    packed_incoming_lists_ = Pack(vertex_count, edges_, &Edge<Weight, Index>::to);
 }
 
-template <typename Weight>
-EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+template <typename Weight, typename Index>
+EdgeId DirectedWeightedGraph<Weight, Index>::AddEdge(const Edge<Weight, Index>& edge) {
+    CheckNotFrozen();
+    CheckIndex(edges_.size());
     edges_.push_back(edge);
     const EdgeId id = edges_.size() - 1;
-    const size_t min_size = std::max(edge.from, edge.to) + 1;
-    if (incidence_lists_.size() < min_size)
+    const size_t min_size = std::max<size_t>(edge.from, edge.to) + 1;
+    if (incidence_lists_.size() < min_size) {
         incidence_lists_.resize(min_size);
+        incoming_lists_.resize(min_size);
+    }
     incidence_lists_[edge.from].push_back(id);
+    incoming_lists_[edge.to].push_back(id);
     return id;
 }
 
-template <typename Weight>
-size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+template <typename Weight, typename Index>
+EdgeId DirectedWeightedGraph<Weight, Index>::AddEdge(VertexId from, VertexId to, Weight weight) {
+    CheckIndex(from);
+    CheckIndex(to);
+    return AddEdge({static_cast<Index>(from), static_cast<Index>(to), weight});
+}
+
+template <typename Weight, typename Index>
+VertexId DirectedWeightedGraph<Weight, Index>::AddVertex() {
+    CheckNotFrozen();
+    CheckIndex(incidence_lists_.size());
+    incidence_lists_.emplace_back();
+    incoming_lists_.emplace_back();
+    return incidence_lists_.size() - 1;
+}
+
+template <typename Weight, typename Index>
+typename DirectedWeightedGraph<Weight, Index>::PackedLists
+DirectedWeightedGraph<Weight, Index>::Pack(size_t vertex_count,
+                                           const std::vector<Edge<Weight, Index>>& edges,
+                                           Index Edge<Weight, Index>::*end) {
+    PackedLists lists;
+    lists.offsets.assign(vertex_count + 1, 0);
+    for (const auto& edge : edges) {
+        ++lists.offsets[edge.*end + 1];
+    }
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        lists.offsets[vertex + 1] += lists.offsets[vertex];
+    }
+    lists.edge_ids.resize(edges.size());
+    std::vector<size_t> positions(lists.offsets.begin(), std::prev(lists.offsets.end()));
+    for (size_t edge_id = 0; edge_id < edges.size(); ++edge_id) {
+        lists.edge_ids[positions[edges[edge_id].*end]++] = static_cast<Index>(edge_id);
+    }
+    return lists;
+}
+
+template <typename Weight, typename Index>
+void DirectedWeightedGraph<Weight, Index>::Freeze() {
+    if (frozen_) {
+        return;
+    }
+    const size_t vertex_count = incidence_lists_.size();
+    packed_incidence_lists_ = Pack(vertex_count, edges_, &Edge<Weight, Index>::from);
+    packed_incoming_lists_ = Pack(vertex_count, edges_, &Edge<Weight, Index>::to);
+    incidence_lists_ = {};
+    incoming_lists_ = {};
+    frozen_ = true;
+}
+
+template <typename Weight, typename Index>
+void DirectedWeightedGraph<Weight, Index>::Thaw() {
+    if (!frozen_) {
+        return;
+    }
+    const size_t vertex_count = GetVertexCount();
+    incidence_lists_.assign(vertex_count, {});
+    incoming_lists_.assign(vertex_count, {});
+    for (size_t edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        incidence_lists_[edges_[edge_id].from].push_back(static_cast<Index>(edge_id));
+        incoming_lists_[edges_[edge_id].to].push_back(static_cast<Index>(edge_id));
+    }
+    packed_incidence_lists_ = {};
+    packed_incoming_lists_ = {};
+    frozen_ = false;
+}
+
+template <typename Weight, typename Index>
+bool DirectedWeightedGraph<Weight, Index>::IsFrozen() const {
+    return frozen_;
+}
+
+template <typename Weight, typename Index>
+size_t DirectedWeightedGraph<Weight, Index>::GetVertexCount() const {
+    return frozen_ ? packed_incidence_lists_.offsets.size() - 1 : incidence_lists_.size();
 }
 
-template <typename Weight>
-size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
+template <typename Weight, typename Index>
+size_t DirectedWeightedGraph<Weight, Index>::GetEdgeCount() const {
     return edges_.size();
 }
 
-template <typename Weight>
-const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
+template <typename Weight, typename Index>
+const Edge<Weight, Index>& DirectedWeightedGraph<Weight, Index>::GetEdge(EdgeId edge_id) const {
     return edges_[edge_id];
 }
 
-template <typename Weight>
-typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
-DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+template <typename Weight, typename Index>
+typename DirectedWeightedGraph<Weight, Index>::IncidentEdgesRange
+DirectedWeightedGraph<Weight, Index>::GetIncidentEdges(VertexId vertex) const {
+    if (frozen_) {
+        return GetList(packed_incidence_lists_, vertex);
+    }
     return ranges::AsRange(incidence_lists_[vertex]);
 }
+
+template <typename Weight, typename Index>
+typename DirectedWeightedGraph<Weight, Index>::IncidentEdgesRange
+DirectedWeightedGraph<Weight, Index>::GetIncomingEdges(VertexId vertex) const {
+    if (frozen_) {
+        return GetList(packed_incoming_lists_, vertex);
+    }
+    return ranges::AsRange(incoming_lists_[vertex]);
+}
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Hub labels (2-hop cover) built by pruned landmark labeling.
+// Every vertex v has forward label: hubs h with weight(v, h), and backward label: hubs h
+// with weight(h, v). For every pair of vertices some hub on a shortest route between them
+// is in both the forward label of the source and the backward label of the target, so route
+// weight is the minimum over common hubs and query is a merge of two lists sorted by hub.
+//
+// Preprocessing takes vertices in order of decreasing degree, runs Dijkstra search from every
+// one in both directions and labels reached vertices with it. Search is pruned at vertices
+// whose route weight is already covered by labels of more important hubs.
+//
+// Label entry also keeps the edge to the next vertex towards the hub (forward label)
+// or from the previous vertex (backward label). The next vertex was expanded by the same
+// search, so it has the hub in its label too, and routes are unpacked by these edges.
+template <typename Weight, typename Index = VertexId>
+class HubLabels {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+    using RouteInfo = typename Router<Weight, Index>::RouteInfo;
+
+    explicit HubLabels(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // weights of routes from every source to every target without routes themselves,
+    // row-major sources.size() * targets.size() matrix, nullopt if there is no route
+    std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+                                                    const std::vector<VertexId>& targets) const;
+
+    // internal types for (de)serialization
+    static constexpr Index NO_EDGE = std::numeric_limits<Index>::max();
+
+    struct LabelEntry {
+        Index hub;      // position of the hub in order
+        Index edge;     // NO_EDGE if the vertex is the hub
+        Weight weight;
+    };
+
+    // labels of all vertices one after another sorted by hub,
+    // label of vertex v is entries[offsets[v] .. offsets[v + 1])
+    struct Labels {
+        std::vector<size_t> offsets;
+        std::vector<LabelEntry> entries;
+    };
+
+    struct HubLabelsInternalData {
+        std::vector<VertexId> order; // hub vertices from the most important one
+        Labels forward;              // weight(vertex, hub), edge from vertex
+        Labels backward;             // weight(hub, vertex), edge to vertex
+    };
+
+    // ctor with fields for deserialization
+    HubLabels(const Graph& graph, HubLabelsInternalData&& data);
+
+    // internal data for serialization
+    const auto& InternalData() const { return data_; }
+
+private:
+    using EntryIterator = typename std::vector<LabelEntry>::const_iterator;
+
+    struct Meeting {
+        Weight weight;
+        EntryIterator forward;  // entry of the hub in forward label of source
+        EntryIterator backward; // entry of the hub in backward label of target
+    };
+
+    std::optional<Meeting> Query(VertexId from, VertexId to) const;
+    const LabelEntry& FindEntry(const Labels& labels, VertexId vertex, Index hub) const;
+    static std::pair<EntryIterator, EntryIterator> GetLabel(const Labels& labels,
+                                                            VertexId vertex);
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+    const Graph& graph_;
+    HubLabelsInternalData data_;
+};
+
+// Pruned landmark labeling
+template <typename Weight, typename Index = VertexId>
+class HubLabelsBuilder {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+    using Labeling = HubLabels<Weight, Index>;
+    using LabelEntry = typename Labeling::LabelEntry;
+    using Labels = typename Labeling::Labels;
+    using HubLabelsInternalData = typename Labeling::HubLabelsInternalData;
+
+    explicit HubLabelsBuilder(const Graph& graph);
+
+    HubLabelsInternalData Build();
+
+private:
+    // search from hub by outgoing edges fills backward labels, by incoming edges forward ones
+    void Search(Index hub, bool is_forward);
+    static Labels Pack(const std::vector<std::vector<LabelEntry>>& labels);
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+    const Graph& graph_;
+    std::vector<VertexId> order_;
+    std::vector<std::vector<LabelEntry>> forward_labels_;
+    std::vector<std::vector<LabelEntry>> backward_labels_;
+
+    // search state, weights of reached vertices are reset after every search
+    std::vector<Weight> weights_;
+    std::vector<Index> edges_;
+    std::vector<VertexId> reached_;
+    // weight(hub, h) (or weight(h, hub)) by h for labels of the current hub
+    std::vector<Weight> hub_weights_;
+};
+
+template <typename Weight, typename Index>
+HubLabels<Weight, Index>::HubLabels(const Graph& graph)
+    : graph_(graph), data_(HubLabelsBuilder<Weight, Index>(graph).Build()) {
+}
+
+template <typename Weight, typename Index>
+HubLabels<Weight, Index>::HubLabels(const Graph& graph, HubLabelsInternalData&& data)
+    : graph_(graph), data_(std::move(data)) {
+    assert(data_.order.size() == graph.GetVertexCount());
+    assert(data_.forward.offsets.size() == graph.GetVertexCount() + 1);
+    assert(data_.backward.offsets.size() == graph.GetVertexCount() + 1);
+}
+
+template <typename Weight, typename Index>
+std::pair<typename HubLabels<Weight, Index>::EntryIterator,
+          typename HubLabels<Weight, Index>::EntryIterator>
+HubLabels<Weight, Index>::GetLabel(const Labels& labels, VertexId vertex) {
+    return {labels.entries.begin() + labels.offsets[vertex],
+            labels.entries.begin() + labels.offsets[vertex + 1]};
+}
+
+template <typename Weight, typename Index>
+std::optional<typename HubLabels<Weight, Index>::Meeting>
+HubLabels<Weight, Index>::Query(VertexId from, VertexId to) const {
+    auto [forward, forward_end] = GetLabel(data_.forward, from);
+    auto [backward, backward_end] = GetLabel(data_.backward, to);
+    std::optional<Meeting> best;
+    while (forward != forward_end && backward != backward_end) {
+        if (forward->hub < backward->hub) {
+            ++forward;
+        } else if (backward->hub < forward->hub) {
+            ++backward;
+        } else {
+            const Weight weight = forward->weight + backward->weight;
+            if (!best || weight < best->weight) {
+                best = Meeting{weight, forward, backward};
+            }
+            ++forward;
+            ++backward;
+        }
+    }
+    return best;
+}
+
+template <typename Weight, typename Index>
+const typename HubLabels<Weight, Index>::LabelEntry&
+HubLabels<Weight, Index>::FindEntry(const Labels& labels, VertexId vertex, Index hub) const {
+    const auto [begin, end] = GetLabel(labels, vertex);
+    const auto it = std::lower_bound(begin, end, hub, [](const LabelEntry& entry, Index hub) {
+        return entry.hub < hub;
+    });
+    assert(it != end && it->hub == hub);
+    return *it;
+}
+
+template <typename Weight, typename Index>
+std::optional<typename HubLabels<Weight, Index>::RouteInfo>
+HubLabels<Weight, Index>::BuildRoute(VertexId from, VertexId to) const {
+    const auto meeting = Query(from, to);
+    if (!meeting) {
+        return std::nullopt;
+    }
+    const Index hub = meeting->forward->hub;
+    RouteInfo route{meeting->weight, {}};
+
+    // from the hub back to the target
+    for (const LabelEntry* entry = &*meeting->backward; entry->edge != NO_EDGE;) {
+        route.edges.push_back(entry->edge);
+        entry = &FindEntry(data_.backward, graph_.GetEdge(entry->edge).from, hub);
+    }
+    std::reverse(route.edges.begin(), route.edges.end());
+
+    // from the source to the hub
+    std::vector<EdgeId> to_hub;
+    for (const LabelEntry* entry = &*meeting->forward; entry->edge != NO_EDGE;) {
+        to_hub.push_back(entry->edge);
+        entry = &FindEntry(data_.forward, graph_.GetEdge(entry->edge).to, hub);
+    }
+    route.edges.insert(route.edges.begin(), to_hub.begin(), to_hub.end());
+    return route;
+}
+
+template <typename Weight, typename Index>
+std::vector<std::optional<Weight>>
+HubLabels<Weight, Index>::BuildWeights(const std::vector<VertexId>& sources,
+                                       const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<Weight>> result;
+    result.reserve(sources.size() * targets.size());
+    for (const VertexId from : sources) {
+        for (const VertexId to : targets) {
+            const auto meeting = Query(from, to);
+            result.push_back(meeting ? std::optional<Weight>(meeting->weight) : std::nullopt);
+        }
+    }
+    return result;
+}
+
+template <typename Weight, typename Index>
+HubLabelsBuilder<Weight, Index>::HubLabelsBuilder(const Graph& graph)
+    : graph_(graph) {
+}
+
+template <typename Weight, typename Index>
+typename HubLabelsBuilder<Weight, Index>::HubLabelsInternalData
+HubLabelsBuilder<Weight, Index>::Build() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (const auto& edge : ranges::AsRange(graph_.EdgesIterators())) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    // vertices with more edges are more likely on shortest routes
+    order_.resize(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order_[vertex] = vertex;
+    }
+    auto degree = [this](VertexId vertex) {
+        const auto outgoing = graph_.GetIncidentEdges(vertex);
+        const auto incoming = graph_.GetIncomingEdges(vertex);
+        return (outgoing.end() - outgoing.begin()) + (incoming.end() - incoming.begin());
+    };
+    std::stable_sort(order_.begin(), order_.end(), [&degree](VertexId lhs, VertexId rhs) {
+        return degree(lhs) > degree(rhs);
+    });
+
+    forward_labels_.assign(vertex_count, {});
+    backward_labels_.assign(vertex_count, {});
+    weights_.assign(vertex_count, INFINITE_WEIGHT);
+    edges_.assign(vertex_count, Labeling::NO_EDGE);
+    hub_weights_.assign(vertex_count, INFINITE_WEIGHT);
+    for (size_t hub = 0; hub < vertex_count; ++hub) {
+        Search(static_cast<Index>(hub), true);
+        Search(static_cast<Index>(hub), false);
+    }
+
+    return {std::move(order_), Pack(forward_labels_), Pack(backward_labels_)};
+}
+
+template <typename Weight, typename Index>
+void HubLabelsBuilder<Weight, Index>::Search(Index hub, bool is_forward) {
+    const VertexId hub_vertex = order_[hub];
+    // search by outgoing edges finds weight(hub, vertex) for backward labels and is pruned
+    // by forward label of the hub, search by incoming edges is symmetric
+    auto& labels = is_forward ? backward_labels_ : forward_labels_;
+    const auto& hub_label = is_forward ? forward_labels_[hub_vertex]
+                                       : backward_labels_[hub_vertex];
+    for (const LabelEntry& entry : hub_label) {
+        hub_weights_[entry.hub] = entry.weight;
+    }
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    weights_[hub_vertex] = ZERO_WEIGHT;
+    reached_.push_back(hub_vertex);
+    queue.push({ZERO_WEIGHT, hub_vertex});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights_[vertex]) {
+            continue;
+        }
+
+        // the route is covered by more important hubs, so are routes through vertex
+        bool is_covered = false;
+        if (vertex != hub_vertex) {
+            for (const LabelEntry& entry : labels[vertex]) {
+                if (hub_weights_[entry.hub] != INFINITE_WEIGHT
+                    && hub_weights_[entry.hub] + entry.weight <= weight) {
+                    is_covered = true;
+                    break;
+                }
+            }
+        }
+        if (is_covered) {
+            continue;
+        }
+        labels[vertex].push_back({hub, edges_[vertex], weight});
+
+        const auto edge_ids = is_forward ? graph_.GetIncidentEdges(vertex)
+                                         : graph_.GetIncomingEdges(vertex);
+        for (const EdgeId edge_id : edge_ids) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const VertexId next = is_forward ? edge.to : edge.from;
+            const Weight next_weight = weight + edge.weight;
+            if (next_weight < weights_[next]) {
+                if (weights_[next] == INFINITE_WEIGHT) {
+                    reached_.push_back(next);
+                }
+                weights_[next] = next_weight;
+                edges_[next] = static_cast<Index>(edge_id);
+                queue.push({next_weight, next});
+            }
+        }
+    }
+
+    for (const VertexId vertex : reached_) {
+        weights_[vertex] = INFINITE_WEIGHT;
+        edges_[vertex] = Labeling::NO_EDGE;
+    }
+    reached_.clear();
+    for (const LabelEntry& entry : hub_label) {
+        hub_weights_[entry.hub] = INFINITE_WEIGHT;
+    }
+}
+
+template <typename Weight, typename Index>
+typename HubLabelsBuilder<Weight, Index>::Labels
+HubLabelsBuilder<Weight, Index>::Pack(const std::vector<std::vector<LabelEntry>>& labels) {
+    Labels result;
+    result.offsets.reserve(labels.size() + 1);
+    result.offsets.push_back(0);
+    for (const auto& label : labels) {
+        result.offsets.push_back(result.offsets.back() + label.size());
+    }
+    result.entries.reserve(result.offsets.back());
+    for (const auto& label : labels) {
+        result.entries.insert(result.entries.end(), label.begin(), label.end());
+    }
+    return result;
+}
+
+}  // namespace graph
@@ -2,6 +2,7 @@
 #include "json_builder.h"
 
 #include <sstream>
+#include <unordered_map>
 
 /*
  * Здесь можно разместить код наполнения транспортного справочника данными из JSON,
@@ -353,41 +354,82 @@ JsonRequestReader::MapStat(const json::Node& map_request, const MapRendererSetti
     }
 
  */
-json::Node
-JsonRequestReader::RouteStat(const json::Node& route_request, TransportRouter& router) {
+JsonRequestReader::RouteRequest
+JsonRequestReader::ReadRouteRequest(const json::Node& route_request) {
 
     const auto& map = route_request.AsMap();
 
     try {
         if (map.at("type"s) != "Route"s)
             throw InputError("request type isn't Route");
-        const int id = map.at("id"s).AsInt();
-        const Stop *from = tc_.GetStop(map.at("from"s).AsString());
-        const Stop *to = tc_.GetStop(map.at("to"s).AsString());
-
-        if (from && to) {
-            auto route = router.Route(from, to);
-            if (route) {
-                auto node = json::Builder()
-                    .StartDict()
-                        .Key("request_id"s).Value(id)
-                        .Key("total_time"s).Value(route->total_time)
-                        .Key("items"s).Value(RouteActivities(*route))
-                    .EndDict()
-                    .Build();
-                return node;
-            }
-        }
+        return {map.at("id"s).AsInt(),
+                tc_.GetStop(map.at("from"s).AsString()),
+                tc_.GetStop(map.at("to"s).AsString())};
+    } catch (const out_of_range& e) { // std::map
+        throw InputError("stop request error");
+    }
+}
 
+json::Node
+JsonRequestReader::RouteStat(int id, const TransportRouter::RouteResult* result) {
+    if (result) {
         return json::Builder()
                .StartDict()
                    .Key("request_id"s).Value(id)
-                   .Key("error_message"s).Value("not found"s)
+                   .Key("total_time"s).Value(result->total_time)
+                   .Key("items"s).Value(RouteActivities(*result))
                .EndDict()
                .Build();
-    } catch (const out_of_range& e) { // std::map
-        throw InputError("stop request error");
-    }}
+    }
+
+    return json::Builder()
+           .StartDict()
+               .Key("request_id"s).Value(id)
+               .Key("error_message"s).Value("not found"s)
+           .EndDict()
+           .Build();
+}
+
+// Маршруты с общей начальной остановкой строятся вместе: поисковые роутеры выполняют
+// один поиск на группу. Ответы записываются в result на места запросов.
+void JsonRequestReader::RouteStats(const vector<pair<size_t, RouteRequest>>& requests,
+                                   TransportRouter& router, json::Array& result) {
+    // индексы запросов по начальной остановке в порядке первого появления
+    unordered_map<const Stop*, size_t> group_indices;
+    vector<vector<size_t>> groups;
+    for (size_t index = 0; index < requests.size(); ++index) {
+        const RouteRequest& request = requests[index].second;
+        if (!request.from || !request.to) {
+            result[requests[index].first] = RouteStat(request.id, nullptr);
+            continue;
+        }
+        auto [it, inserted] = group_indices.insert({request.from, groups.size()});
+        if (inserted) {
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(index);
+    }
+
+    vector<const Stop*> targets;
+    for (const auto& group : groups) {
+        const Stop* from = requests[group.front()].second.from;
+        if (group.size() == 1) {
+            const auto& [position, request] = requests[group.front()];
+            const bool found = router.Route(from, request.to, route_result_);
+            result[position] = RouteStat(request.id, found ? &route_result_ : nullptr);
+            continue;
+        }
+        targets.clear();
+        for (const size_t index : group) {
+            targets.push_back(requests[index].second.to);
+        }
+        const auto routes = router.RouteFrom(from, targets);
+        for (size_t i = 0; i < group.size(); ++i) {
+            const auto& [position, request] = requests[group[i]];
+            result[position] = RouteStat(request.id, routes[i] ? &*routes[i] : nullptr);
+        }
+    }
+}
 
 
 /*
@@ -448,6 +490,163 @@ JsonRequestReader::RouteActivities(const TransportRouter::RouteResult& route) {
 }
 
 
+/*
+    Запрос матрицы времён маршрутов. Словарь:
+
+    "type": "Matrix"
+    from — массив остановок, где начинаются маршруты.
+    to — массив остановок, где заканчиваются маршруты.
+
+    Пример
+    {
+        "type": "Matrix",
+        "from": ["Biryulyovo Zapadnoye", "Universam"],
+        "to": ["Universam", "Prazhskaya"],
+        "id": 5
+    }
+
+    Ответ:
+    {
+        "request_id": <id запроса>,
+        "total_times": [
+            [<время от from[0] до to[0]>, <время от from[0] до to[1]>, ...],
+            ...
+        ]
+    }
+
+    total_times[i][j] — суммарное время маршрута от from[i] до to[j], как total_time
+    в ответе на запрос Route, или null, если маршрута нет. Сами маршруты не строятся,
+    матрица вычисляется за один проход для всех пар остановок.
+ */
+json::Node
+JsonRequestReader::MatrixStat(const json::Node& matrix_request, const TransportRouter& router) {
+
+    const auto& map = matrix_request.AsMap();
+
+    try {
+        if (map.at("type"s) != "Matrix"s)
+            throw InputError("request type isn't Matrix");
+        const int id = map.at("id"s).AsInt();
+
+        // unknown stops are skipped in calculation and get null times
+        auto read_stops = [this](const json::Node& names, vector<const Stop*>& known_stops,
+                                 vector<optional<size_t>>& indices) {
+            for (const auto& name : names.AsArray()) {
+                const Stop* stop = tc_.GetStop(name.AsString());
+                if (stop) {
+                    indices.push_back(known_stops.size());
+                    known_stops.push_back(stop);
+                } else {
+                    indices.push_back(nullopt);
+                }
+            }
+        };
+        vector<const Stop*> from, to;
+        vector<optional<size_t>> from_indices, to_indices;
+        read_stops(map.at("from"s), from, from_indices);
+        read_stops(map.at("to"s), to, to_indices);
+
+        const auto times = router.RouteTimes(from, to);
+
+        json::Array rows;
+        for (const auto& from_index : from_indices) {
+            json::Array row;
+            for (const auto& to_index : to_indices) {
+                if (from_index && to_index && times[*from_index][*to_index]) {
+                    row.push_back(*times[*from_index][*to_index]);
+                } else {
+                    row.push_back(nullptr);
+                }
+            }
+            rows.push_back(move(row));
+        }
+
+        return json::Builder()
+               .StartDict()
+                   .Key("request_id"s).Value(id)
+                   .Key("total_times"s).Value(move(rows))
+               .EndDict()
+               .Build();
+    } catch (const out_of_range& e) { // std::map
+        throw InputError("matrix request error");
+    }
+}
+
+/*
+    Запрос изохроны — всех остановок, достижимых от остановки за заданное время. Словарь:
+
+    "type": "Isochrone"
+    from — остановка, где начинаются маршруты.
+    max_time — время в минутах, вещественное число.
+
+    Пример
+    {
+        "type": "Isochrone",
+        "from": "Biryulyovo Zapadnoye",
+        "max_time": 30,
+        "id": 6
+    }
+
+    Ответ:
+    {
+        "request_id": <id запроса>,
+        "stops": [
+            {
+                "stop_name": "Biryulyovo Zapadnoye",
+                "time": 0
+            },
+            ...
+        ]
+    }
+
+    stops — остановки, время маршрута до которых не больше max_time, по возрастанию времени
+    (при равном времени — по названию). Начальная остановка входит в список с временем 0.
+    Вычисляется одним поиском, ограниченным max_time, или просмотром строки таблицы маршрутов
+    "all_pairs". Если остановки from нет, выводится error_message "not found".
+ */
+json::Node
+JsonRequestReader::IsochroneStat(const json::Node& isochrone_request,
+                                 const TransportRouter& router) {
+
+    const auto& map = isochrone_request.AsMap();
+
+    try {
+        if (map.at("type"s) != "Isochrone"s)
+            throw InputError("request type isn't Isochrone");
+        const int id = map.at("id"s).AsInt();
+        const Stop *from = tc_.GetStop(map.at("from"s).AsString());
+        const double max_time = map.at("max_time"s).AsDouble();
+
+        if (!from) {
+            return json::Builder()
+                   .StartDict()
+                       .Key("request_id"s).Value(id)
+                       .Key("error_message"s).Value("not found"s)
+                   .EndDict()
+                   .Build();
+        }
+
+        json::Array stops;
+        for (const auto& [stop, time] : router.Reachable(from, max_time)) {
+            stops.push_back(json::Builder()
+                            .StartDict()
+                                .Key("stop_name"s).Value(stop->Name())
+                                .Key("time"s).Value(time)
+                            .EndDict()
+                            .Build());
+        }
+
+        return json::Builder()
+               .StartDict()
+                   .Key("request_id"s).Value(id)
+                   .Key("stops"s).Value(move(stops))
+               .EndDict()
+               .Build();
+    } catch (const out_of_range& e) { // std::map
+        throw InputError("isochrone request error");
+    }
+}
+
 /*
     Массив base_requests содержит элементы двух типов: маршруты и остановки. Они перечисляются
     в произвольном порядке.
@@ -515,11 +714,13 @@ void JsonRequestReader::ReadBase(const json::Document& doc) {
 json::Node
 JsonRequestReader::ReadStat(const json::Document& doc,
                             const MapRendererSettings& render_settings,
-                            TransportRouter& router) {
+                            const RouterProvider& router) {
     try {
         const json::Node& stat_requests = doc.GetRoot().AsMap().at("stat_requests"s);
 
         json::Array result;
+        // route requests are answered together after others, (position, request)
+        vector<pair<size_t, RouteRequest>> route_requests;
 
         const json::Array& array = stat_requests.AsArray();
         for (const auto& node : array) {
@@ -531,12 +732,20 @@ JsonRequestReader::ReadStat(const json::Document& doc,
             } else if (request_type == "Map") {
                 result.push_back(MapStat(node, render_settings));
             } else if (request_type == "Route") {
-                result.push_back(RouteStat(node, router));
+                route_requests.push_back({result.size(), ReadRouteRequest(node)});
+                result.emplace_back();
+            } else if (request_type == "Matrix") {
+                result.push_back(MatrixStat(node, router()));
+            } else if (request_type == "Isochrone") {
+                result.push_back(IsochroneStat(node, router()));
             }
             else {
                 throw InputError("unknown stat request type"s);
             }
         }
+        if (!route_requests.empty()) {
+            RouteStats(route_requests, router(), result);
+        }
 
         return {result};
 
@@ -632,6 +841,53 @@ JsonRequestReader::ReadColorPallete(const json::Node& pallete_node) {
 
     bus_velocity — скорость автобуса, в км/ч. Значение — вещественное число от 1 до 1000.
 
+    router — необязательный способ поиска маршрутов:
+        "all_pairs" (по умолчанию для graph_model "stop_pairs") — таблица всех маршрутов
+            строится в make_base;
+        "dijkstra" (по умолчанию для graph_model "wait_and_ride") — поиск выполняется
+            на каждый запрос, в базе хранится только граф;
+        "bidirectional_dijkstra" — поиск на каждый запрос одновременно от начальной остановки
+            и от конечной по входящим рёбрам до встречи фронтов;
+        "raptor" — поиск по раундам на каждый запрос (раунд — одна посадка в автобус),
+            сканируются последовательности остановок автобусов, граф маршрутов не строится
+            и graph_model не используется;
+        "contraction_hierarchies" — в make_base строится иерархия сокращений (порядок вершин
+            и shortcut-рёбра), запрос выполняется двунаправленным поиском вверх по иерархии;
+        "astar" — поиск A* на каждый запрос, нижняя оценка времени до цели вычисляется
+            по расстоянию между координатами остановок;
+        "alt" — поиск A* на каждый запрос, нижняя оценка времени до цели вычисляется
+            по неравенству треугольника через ориентиры (landmarks): в make_base выбираются
+            остановки-ориентиры и сохраняется время проезда от каждого ориентира до всех вершин
+            графа и обратно;
+        "hub_labels" — в make_base каждой вершине графа строятся метки: списки вершин-хабов
+            с временем проезда до них и от них (pruned landmark labeling), время маршрута
+            вычисляется слиянием метки начальной вершины и метки конечной.
+
+    landmark_count — необязательное число ориентиров для "alt", целое неотрицательное число,
+    по умолчанию 8.
+
+    route_cache_size — необязательный размер кэша ответов на запросы Route (пары остановок,
+    вытесняется давно не использованная), целое неотрицательное число, по умолчанию 0 —
+    кэш отключён.
+
+    parallel_search_min_vertices — необязательное число вершин графа, начиная с которого поиски
+    от одной остановки до всех (группы запросов Route от одной остановки, Isochrone) поисковых
+    роутеров выполняются параллельно методом delta-stepping, целое неотрицательное число,
+    по умолчанию 20000.
+
+    graph_model — необязательная модель графа маршрутов:
+        "stop_pairs" (по умолчанию) — ребро между каждой парой остановок автобуса,
+            O(n^2) рёбер на автобус;
+        "wait_and_ride" — вершины остановок и вершины поездки для каждой остановки автобуса,
+            рёбра ожидания, проезда до следующей остановки и выхода, O(n) рёбер на автобус.
+            Таблица "all_pairs" для такого графа слишком велика, подходят поисковые роутеры,
+            поэтому без ключа router используется "dijkstra".
+
+    vertex_order — необязательный порядок нумерации вершин остановок в графе:
+        "stops" (по умолчанию) — в порядке добавления остановок;
+        "hilbert" — вдоль кривой Гильберта по координатам остановок, близкие остановки получают
+            близкие номера, что улучшает локальность строк таблицы "all_pairs" и списков рёбер.
+
     Пример:
     "routing_settings": {
       "bus_wait_time": 6,
@@ -648,6 +904,37 @@ JsonRequestReader::ReadRoutingSettings(const json::Document& doc) {
             auto map = iter->second.AsMap();
             settings.bus_wait_time = map.at("bus_wait_time").AsInt();
             settings.bus_velocity = map.at("bus_velocity").AsDouble();
+            if (auto model_iter = map.find("graph_model"s); model_iter != map.end()) {
+                settings.graph_model = ReadGraphModel(model_iter->second);
+            }
+            if (auto router_iter = map.find("router"s); router_iter != map.end()) {
+                settings.router = ReadRouterType(router_iter->second);
+            } else if (settings.graph_model == GraphModel::WAIT_AND_RIDE) {
+                // all_pairs table of ride vertices takes O(V^2) memory
+                settings.router = RouterType::DIJKSTRA;
+            }
+            if (auto order_iter = map.find("vertex_order"s); order_iter != map.end()) {
+                settings.vertex_order = ReadVertexOrder(order_iter->second);
+            }
+            if (auto count_iter = map.find("landmark_count"s); count_iter != map.end()) {
+                settings.landmark_count = count_iter->second.AsInt();
+                if (settings.landmark_count < 0) {
+                    throw InputError("landmark_count must be non-negative"s);
+                }
+            }
+            if (auto size_iter = map.find("route_cache_size"s); size_iter != map.end()) {
+                settings.route_cache_size = size_iter->second.AsInt();
+                if (settings.route_cache_size < 0) {
+                    throw InputError("route_cache_size must be non-negative"s);
+                }
+            }
+            if (auto min_iter = map.find("parallel_search_min_vertices"s);
+                min_iter != map.end()) {
+                settings.parallel_search_min_vertices = min_iter->second.AsInt();
+                if (settings.parallel_search_min_vertices < 0) {
+                    throw InputError("parallel_search_min_vertices must be non-negative"s);
+                }
+            }
         }
         return settings;
     } catch (const out_of_range& e) {
@@ -657,6 +944,54 @@ JsonRequestReader::ReadRoutingSettings(const json::Document& doc) {
     }
 }
 
+RouterType
+JsonRequestReader::ReadRouterType(const json::Node& router_node) {
+    const string& name = router_node.AsString();
+    if (name == "all_pairs"s) {
+        return RouterType::ALL_PAIRS;
+    } else if (name == "dijkstra"s) {
+        return RouterType::DIJKSTRA;
+    } else if (name == "contraction_hierarchies"s) {
+        return RouterType::CONTRACTION_HIERARCHIES;
+    } else if (name == "astar"s) {
+        return RouterType::ASTAR;
+    } else if (name == "alt"s) {
+        return RouterType::ALT;
+    } else if (name == "bidirectional_dijkstra"s) {
+        return RouterType::BIDIRECTIONAL_DIJKSTRA;
+    } else if (name == "raptor"s) {
+        return RouterType::RAPTOR;
+    } else if (name == "hub_labels"s) {
+        return RouterType::HUB_LABELS;
+    } else {
+        throw InputError("unknown router "s + name);
+    }
+}
+
+GraphModel
+JsonRequestReader::ReadGraphModel(const json::Node& model_node) {
+    const string& name = model_node.AsString();
+    if (name == "stop_pairs"s) {
+        return GraphModel::STOP_PAIRS;
+    } else if (name == "wait_and_ride"s) {
+        return GraphModel::WAIT_AND_RIDE;
+    } else {
+        throw InputError("unknown graph model "s + name);
+    }
+}
+
+VertexOrder
+JsonRequestReader::ReadVertexOrder(const json::Node& order_node) {
+    const string& name = order_node.AsString();
+    if (name == "stops"s) {
+        return VertexOrder::STOPS;
+    } else if (name == "hilbert"s) {
+        return VertexOrder::HILBERT;
+    } else {
+        throw InputError("unknown vertex order "s + name);
+    }
+}
+
 serialization::Settings
 JsonRequestReader::ReadSerializationSettings(const json::Document& doc) {
     try {
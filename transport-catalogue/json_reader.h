@@ -6,11 +6,14 @@
  */
 
 #include <deque>
+#include <functional>
 #include <stdexcept>
 #include <string>
 #include <tuple>
 #include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "json.h"
 #include "transport_catalogue.h"
@@ -33,9 +36,11 @@ public:
     JsonRequestReader(TransportCatalogue& tc);
 
     void ReadBase(const json::Document& doc);
+    // router is requested on the first routing request only
+    using RouterProvider = std::function<TransportRouter&()>;
     json::Node ReadStat(const json::Document& doc,
                         const MapRendererSettings& render_settings,
-                        TransportRouter& router);
+                        const RouterProvider& router);
     MapRendererSettings ReadRendererSettings(const json::Document& doc);
     RoutingSettings ReadRoutingSettings(const json::Document& doc);
     serialization::Settings ReadSerializationSettings(const json::Document& doc);
@@ -48,12 +53,29 @@ private:
     json::Node BusStat(const json::Node& bus_request);
     json::Node StopStat(const json::Node& stop_request);
     json::Node MapStat(const json::Node& map_request, const MapRendererSettings& settings);
-    json::Node RouteStat(const json::Node& route_request, TransportRouter& router);
+    // stops are nullptr if they are unknown
+    struct RouteRequest {
+        int id;
+        const Stop* from;
+        const Stop* to;
+    };
+    RouteRequest ReadRouteRequest(const json::Node& route_request);
+    // "not found" answer if result is nullptr
+    json::Node RouteStat(int id, const TransportRouter::RouteResult* result);
+    // answers to requests are written to result at their positions
+    void RouteStats(const std::vector<std::pair<size_t, RouteRequest>>& requests,
+                    TransportRouter& router, json::Array& result);
     json::Node RouteActivities(const TransportRouter::RouteResult& result);
+    json::Node MatrixStat(const json::Node& matrix_request, const TransportRouter& router);
+    json::Node IsochroneStat(const json::Node& isochrone_request, const TransportRouter& router);
     svg::Color ReadColor(const json::Node& color_node);
     std::vector<svg::Color> ReadColorPallete(const json::Node& pallete_node);
+    RouterType ReadRouterType(const json::Node& router_node);
+    GraphModel ReadGraphModel(const json::Node& model_node);
+    VertexOrder ReadVertexOrder(const json::Node& order_node);
 
     TransportCatalogue& tc_;
+    TransportRouter::RouteResult route_result_; // reused by route requests
 };
 
 } // namespace tcat::io
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Landmarks for ALT (A*, landmarks, triangle inequality) search.
+// Preprocessing picks landmarks one by one, every next landmark is the vertex farthest from
+// already picked ones, and stores route weights from every landmark to every vertex and back.
+// By triangle inequality for landmark L
+//   weight(L, target) - weight(L, vertex) <= weight(vertex, target)
+//   weight(vertex, L) - weight(target, L) <= weight(vertex, target)
+// so maximum over landmarks is consistent potential for A* search.
+template <typename Weight, typename Index = VertexId>
+class Landmarks {
+public:
+    using Graph = DirectedWeightedGraph<Weight, Index>;
+
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+    // landmarks are picked among candidates, the first one is the farthest candidate
+    // from candidates[0], equally far candidates are picked in their order
+    Landmarks(const Graph& graph, size_t landmark_count,
+              const std::vector<VertexId>& candidates);
+
+    // lower bound of route weight from vertex to target,
+    // INFINITE_WEIGHT if there is no route for sure
+    Weight Potential(VertexId vertex, VertexId target) const;
+
+    // internal types for (de)serialization
+    // Weights are stored in row-major landmarks.size() * vertex_count matrices,
+    // INFINITE_WEIGHT if there is no route.
+    struct LandmarksInternalData {
+        size_t vertex_count = 0;
+        std::vector<VertexId> landmarks;
+        std::vector<Weight> from_landmark; // weight(landmark, vertex)
+        std::vector<Weight> to_landmark;   // weight(vertex, landmark)
+    };
+
+    // ctor with fields for deserialization
+    Landmarks(const Graph& graph, LandmarksInternalData&& data);
+
+    // internal data for serialization
+    const auto& InternalData() const { return data_; }
+
+private:
+    // compute route weights from source (or to source if backward) to all vertices
+    void ComputeWeights(VertexId source, bool backward, Weight* weights) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+
+    const Graph& graph_;
+    LandmarksInternalData data_;
+};
+
+template <typename Weight, typename Index>
+Landmarks<Weight, Index>::Landmarks(const Graph& graph, size_t landmark_count,
+                                    const std::vector<VertexId>& candidates)
+    : graph_(graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    landmark_count = std::min(landmark_count, candidates.size());
+    data_.vertex_count = vertex_count;
+    if (landmark_count == 0) {
+        return;
+    }
+
+    for (const auto& edge : ranges::AsRange(graph.EdgesIterators())) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    data_.landmarks.reserve(landmark_count);
+    data_.from_landmark.resize(landmark_count * vertex_count);
+    data_.to_landmark.resize(landmark_count * vertex_count);
+
+    // the first landmark is the farthest candidate from the first one
+    std::vector<Weight> nearest(vertex_count);
+    ComputeWeights(candidates.front(), false, nearest.data());
+    std::vector<bool> is_landmark(vertex_count, false);
+    for (size_t index = 0; index < landmark_count; ++index) {
+        VertexId landmark = candidates.front();
+        for (const VertexId vertex : candidates) {
+            assert(vertex < vertex_count);
+            if (!is_landmark[vertex]
+                && (is_landmark[landmark] || nearest[vertex] > nearest[landmark])) {
+                landmark = vertex;
+            }
+        }
+        is_landmark[landmark] = true;
+        data_.landmarks.push_back(landmark);
+
+        Weight* from_landmark = &data_.from_landmark[index * vertex_count];
+        Weight* to_landmark = &data_.to_landmark[index * vertex_count];
+        ComputeWeights(landmark, false, from_landmark);
+        ComputeWeights(landmark, true, to_landmark);
+        if (index == 0) {
+            nearest.assign(vertex_count, INFINITE_WEIGHT);
+        }
+        // round trip weight to the nearest landmark
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            const Weight round_trip = from_landmark[vertex] == INFINITE_WEIGHT
+                                              || to_landmark[vertex] == INFINITE_WEIGHT
+                                          ? INFINITE_WEIGHT
+                                          : from_landmark[vertex] + to_landmark[vertex];
+            nearest[vertex] = std::min(nearest[vertex], round_trip);
+        }
+    }
+}
+
+template <typename Weight, typename Index>
+Landmarks<Weight, Index>::Landmarks(const Graph& graph, LandmarksInternalData&& data)
+    : graph_(graph), data_(std::move(data)) {
+    assert(data_.vertex_count == graph.GetVertexCount());
+    assert(data_.from_landmark.size() == data_.landmarks.size() * data_.vertex_count);
+    assert(data_.to_landmark.size() == data_.landmarks.size() * data_.vertex_count);
+}
+
+template <typename Weight, typename Index>
+Weight Landmarks<Weight, Index>::Potential(VertexId vertex, VertexId target) const {
+    Weight potential = ZERO_WEIGHT;
+    for (size_t index = 0; index < data_.landmarks.size(); ++index) {
+        const Weight* from_landmark = &data_.from_landmark[index * data_.vertex_count];
+        const Weight* to_landmark = &data_.to_landmark[index * data_.vertex_count];
+
+        // landmark reaches vertex but not target, so vertex doesn't reach target
+        if (from_landmark[vertex] != INFINITE_WEIGHT) {
+            if (from_landmark[target] == INFINITE_WEIGHT) {
+                return INFINITE_WEIGHT;
+            }
+            if (from_landmark[target] > from_landmark[vertex]) {
+                potential = std::max(potential, from_landmark[target] - from_landmark[vertex]);
+            }
+        }
+        // target reaches landmark but vertex doesn't, so vertex doesn't reach target
+        if (to_landmark[target] != INFINITE_WEIGHT) {
+            if (to_landmark[vertex] == INFINITE_WEIGHT) {
+                return INFINITE_WEIGHT;
+            }
+            if (to_landmark[vertex] > to_landmark[target]) {
+                potential = std::max(potential, to_landmark[vertex] - to_landmark[target]);
+            }
+        }
+    }
+    return potential;
+}
+
+template <typename Weight, typename Index>
+void Landmarks<Weight, Index>::ComputeWeights(VertexId source, bool backward,
+                                              Weight* weights) const {
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    std::fill(weights, weights + graph_.GetVertexCount(), INFINITE_WEIGHT);
+    weights[source] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, source});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue; // outdated item
+        }
+        const auto relax = [&](EdgeId edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const VertexId next = backward ? edge.from : edge.to;
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < weights[next]) {
+                weights[next] = candidate_weight;
+                queue.push({candidate_weight, next});
+            }
+        };
+        if (backward) {
+            for (const EdgeId edge_id : graph_.GetIncomingEdges(vertex)) {
+                relax(edge_id);
+            }
+        } else {
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                relax(edge_id);
+            }
+        }
+    }
+}
+
+}  // namespace graph
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace cache {
+
+// Bounded map which evicts the least recently used item when it is full.
+// All methods may be called concurrently.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {
+        assert(capacity_ > 0);
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // copy of value, the item becomes the most recently used
+    std::optional<Value> Get(const Key& key) {
+        std::lock_guard lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return std::nullopt;
+        }
+        ++hits_;
+        items_.splice(items_.begin(), items_, it->second);
+        return it->second->second;
+    }
+
+    // insert or replace value, the item becomes the most recently used
+    void Put(const Key& key, Value value) {
+        std::lock_guard lock(mutex_);
+        if (auto it = index_.find(key); it != index_.end()) {
+            it->second->second = std::move(value);
+            items_.splice(items_.begin(), items_, it->second);
+            return;
+        }
+        if (items_.size() == capacity_) {
+            index_.erase(items_.back().first);
+            items_.pop_back();
+        }
+        items_.emplace_front(key, std::move(value));
+        index_.emplace(key, items_.begin());
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    size_t Size() const {
+        std::lock_guard lock(mutex_);
+        return items_.size();
+    }
+
+    size_t Hits() const {
+        return hits_;
+    }
+
+    size_t Misses() const {
+        return misses_;
+    }
+
+private:
+    using Items = std::list<std::pair<Key, Value>>; // the most recently used first
+
+    const size_t capacity_;
+    Items items_;
+    std::unordered_map<Key, typename Items::iterator, Hash> index_;
+    mutable std::mutex mutex_;
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> misses_{0};
+};
+
+} // namespace cache
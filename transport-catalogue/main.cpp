@@ -14,7 +14,7 @@ using namespace std::literals;
 using namespace tcat;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests]\n"sv;
 }
 
 int main(int argc, char* argv[]) {
@@ -63,6 +63,47 @@ int main(int argc, char* argv[]) {
                                      transport_router};
         io::serialization::Serialize(base, out);
 
+    } else if (mode == "update_base"sv) {
+
+        db::TransportCatalogue transport_catalogue;
+        io::MapRendererSettings render_settings;
+        db::RoutingSettings routing_settings;
+        std::unique_ptr<db::TransportRouter> transport_router;
+
+        // load json
+        auto document = json::Load(*in);
+        io::JsonRequestReader json_reader(transport_catalogue);
+
+        // deserialize existing base, settings are kept
+        const auto serialization_settings = json_reader.ReadSerializationSettings(document);
+        io::serialization::Base base{transport_catalogue,
+                                     render_settings,
+                                     routing_settings,
+                                     transport_router};
+        {
+            ifstream input(serialization_settings.file, ios::binary);
+            assert(input.good());
+            io::serialization::Deserialize(input, base);
+        }
+        assert(transport_router);
+
+        // read new stops and buses of base_requests, new buses follow existing ones
+        const auto [old_buses_begin, old_buses_end] = transport_catalogue.BusesIterators();
+        const auto bus_count = distance(old_buses_begin, old_buses_end);
+        json_reader.ReadBase(document);
+
+        // update transport router by new stops and buses
+        transport_router->AddStops();
+        const auto [buses_begin, buses_end] = transport_catalogue.BusesIterators();
+        for (auto bus_it = next(buses_begin, bus_count); bus_it != buses_end; ++bus_it) {
+            transport_router->AddBus(&*bus_it);
+        }
+
+        // serialize
+        ofstream out(serialization_settings.file, ios::binary);
+        assert(out.good());
+        io::serialization::Serialize(base, out);
+
     } else if (mode == "process_requests"sv) {
 
         db::TransportCatalogue transport_catalogue;
@@ -79,19 +120,26 @@ int main(int argc, char* argv[]) {
         ifstream input(serialization_settings.file, ios::binary);
         assert(input.good());
 
-        // deserialize
+        // deserialize, transport router is loaded by the first routing request
         io::serialization::Base base{transport_catalogue,
                                      render_settings,
                                      routing_settings,
                                      transport_router};
-        io::serialization::Deserialize(input, base);
-        assert(transport_router);
+        auto router_loader = io::serialization::DeserializeLazy(input, base);
+        assert(router_loader);
 
         // process stat_requests
-        auto stat = json_reader.ReadStat(document, render_settings, *transport_router);
+        auto stat = json_reader.ReadStat(document, render_settings, router_loader);
         json::Document stat_document{stat};
         json::Print(stat_document, std::cout);
 
+        // route cache counters go to stderr, the answer stays the same
+        if (transport_router && routing_settings.route_cache_size > 0) {
+            const auto stats = transport_router->GetRouteCacheStats();
+            cerr << "route cache: "sv << stats.hits << " hits, "sv << stats.misses
+                 << " misses\n"sv;
+        }
+
     } else {
         PrintUsage();
         return 1;
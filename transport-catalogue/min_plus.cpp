@@ -0,0 +1,160 @@
+#include "min_plus.h"
+
+#include <cassert>
+#include <initializer_list>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIN_PLUS_X86
+#include <immintrin.h>
+#endif
+
+namespace graph::min_plus {
+
+namespace {
+
+void RelaxRowScalar(double weight_from, PrevEdge prev_edge_from,
+                    const double* weights_through, const PrevEdge* prev_edges_through,
+                    double* weights, PrevEdge* prev_edges, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const double candidate_weight = weight_from + weights_through[i];
+        if (candidate_weight < weights[i]) {
+            weights[i] = candidate_weight;
+            prev_edges[i] = prev_edges_through[i] != NO_EDGE ? prev_edges_through[i]
+                                                             : prev_edge_from;
+        }
+    }
+}
+
+#ifdef MIN_PLUS_X86
+
+// Infinite weights need no special care: inf + w == inf is never less than a weight.
+// Lanes of weight comparison mask are narrowed to prev edge lanes and both rows are
+// updated by blend, blocks without improvements aren't stored.
+
+__attribute__((target("sse4.1")))
+void RelaxRowSse41(double weight_from, PrevEdge prev_edge_from,
+                   const double* weights_through, const PrevEdge* prev_edges_through,
+                   double* weights, PrevEdge* prev_edges, size_t count) {
+    const __m128d from = _mm_set1_pd(weight_from);
+    const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m128i no_edge = _mm_set1_epi32(static_cast<int>(NO_EDGE));
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128d candidate = _mm_add_pd(from, _mm_loadu_pd(weights_through + i));
+        const __m128d current = _mm_loadu_pd(weights + i);
+        const __m128d less = _mm_cmplt_pd(candidate, current);
+        if (_mm_movemask_pd(less) == 0) {
+            continue;
+        }
+        _mm_storeu_pd(weights + i, _mm_blendv_pd(current, candidate, less));
+
+        const __m128i prev_through =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev_edges_through + i));
+        const __m128i prev_candidate =
+            _mm_blendv_epi8(prev_through, prev_from, _mm_cmpeq_epi32(prev_through, no_edge));
+        // 64-bit lanes 0, 1 -> 32-bit lanes 0, 1
+        const __m128i less32 =
+            _mm_shuffle_epi32(_mm_castpd_si128(less), _MM_SHUFFLE(3, 3, 2, 0));
+        __m128i* prev = reinterpret_cast<__m128i*>(prev_edges + i);
+        _mm_storel_epi64(prev, _mm_blendv_epi8(_mm_loadl_epi64(prev), prev_candidate, less32));
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, weights_through + i, prev_edges_through + i,
+                   weights + i, prev_edges + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double weight_from, PrevEdge prev_edge_from,
+                  const double* weights_through, const PrevEdge* prev_edges_through,
+                  double* weights, PrevEdge* prev_edges, size_t count) {
+    const __m256d from = _mm256_set1_pd(weight_from);
+    const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m128i no_edge = _mm_set1_epi32(static_cast<int>(NO_EDGE));
+    const __m256i even_lanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(weights_through + i));
+        const __m256d current = _mm256_loadu_pd(weights + i);
+        const __m256d less = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(less) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(weights + i, _mm256_blendv_pd(current, candidate, less));
+
+        const __m128i prev_through =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_through + i));
+        const __m128i prev_candidate =
+            _mm_blendv_epi8(prev_through, prev_from, _mm_cmpeq_epi32(prev_through, no_edge));
+        // 64-bit lanes 0..3 -> 32-bit lanes 0..3
+        const __m128i less32 = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_castpd_si256(less), even_lanes));
+        __m128i* prev = reinterpret_cast<__m128i*>(prev_edges + i);
+        _mm_storeu_si128(prev, _mm_blendv_epi8(_mm_loadu_si128(prev), prev_candidate, less32));
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, weights_through + i, prev_edges_through + i,
+                   weights + i, prev_edges + i, count - i);
+}
+
+#endif // MIN_PLUS_X86
+
+Kernel SelectKernel() {
+    for (const Kernel kernel : {Kernel::AVX2, Kernel::SSE41}) {
+        if (IsSupported(kernel)) {
+            return kernel;
+        }
+    }
+    return Kernel::SCALAR;
+}
+
+} // namespace
+
+bool IsSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::SCALAR:
+            return true;
+#ifdef MIN_PLUS_X86
+        case Kernel::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case Kernel::SSE41:
+        case Kernel::AVX2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+Kernel BestKernel() {
+    static const Kernel kernel = SelectKernel();
+    return kernel;
+}
+
+RelaxRowFunc GetRelaxRow(Kernel kernel) {
+    assert(IsSupported(kernel));
+    switch (kernel) {
+        case Kernel::SCALAR:
+            return RelaxRowScalar;
+#ifdef MIN_PLUS_X86
+        case Kernel::SSE41:
+            return RelaxRowSse41;
+        case Kernel::AVX2:
+            return RelaxRowAvx2;
+#else
+        case Kernel::SSE41:
+        case Kernel::AVX2:
+            break;
+#endif
+    }
+    return RelaxRowScalar;
+}
+
+void RelaxRow(double weight_from, PrevEdge prev_edge_from,
+              const double* weights_through, const PrevEdge* prev_edges_through,
+              double* weights, PrevEdge* prev_edges, size_t count) {
+    static const RelaxRowFunc relax_row = GetRelaxRow(BestKernel());
+    relax_row(weight_from, prev_edge_from, weights_through, prev_edges_through,
+              weights, prev_edges, count);
+}
+
+} // namespace graph::min_plus
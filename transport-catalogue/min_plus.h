@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace graph::min_plus {
+
+// Min-plus relaxation of one row of a route table by one intermediate vertex.
+// Tables are row-major arrays of route weights (+inf if there is no route) and
+// last edges of routes (NO_EDGE for empty route). For every i < count:
+//   if weight_from + weights_through[i] < weights[i] then
+//     weights[i] = weight_from + weights_through[i]
+//     prev_edges[i] = prev_edges_through[i] != NO_EDGE ? prev_edges_through[i] : prev_edge_from
+// weight_from must be finite, rows must not overlap unless the relaxation can't change them.
+
+using PrevEdge = uint32_t;
+constexpr PrevEdge NO_EDGE = std::numeric_limits<PrevEdge>::max();
+
+enum class Kernel {
+    SCALAR,
+    SSE41,  // 2 weights per instruction
+    AVX2,   // 4 weights per instruction
+};
+
+using RelaxRowFunc = void (*)(double weight_from, PrevEdge prev_edge_from,
+                              const double* weights_through, const PrevEdge* prev_edges_through,
+                              double* weights, PrevEdge* prev_edges, size_t count);
+
+// whether the kernel is built in and supported by the CPU
+bool IsSupported(Kernel kernel);
+
+// the fastest supported kernel, selected once at runtime
+Kernel BestKernel();
+
+// kernel must be supported
+RelaxRowFunc GetRelaxRow(Kernel kernel);
+
+// relaxation by the best kernel
+void RelaxRow(double weight_from, PrevEdge prev_edge_from,
+              const double* weights_through, const PrevEdge* prev_edges_through,
+              double* weights, PrevEdge* prev_edges, size_t count);
+
+} // namespace graph::min_plus
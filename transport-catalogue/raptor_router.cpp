@@ -0,0 +1,199 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
+
+namespace tcat::db {
+
+using namespace std;
+
+namespace {
+
+const double INFINITE_TIME = numeric_limits<double>::infinity();
+const size_t NO_POSITION = numeric_limits<size_t>::max();
+
+} // namespace
+
+RaptorRouter::RaptorRouter(const TransportCatalogue& tc, double bus_wait_time,
+                           double bus_velocity)
+    : bus_wait_time_(bus_wait_time), bus_velocity_(bus_velocity) {
+    const auto [stops_begin, stops_end] = tc.StopsIterators();
+    for (auto stop_it = stops_begin; stop_it != stops_end; ++stop_it) {
+        stop_indices_.insert({&*stop_it, stops_.size()});
+        stops_.push_back(&*stop_it);
+    }
+
+    const auto [buses_begin, buses_end] = tc.BusesIterators();
+    for (auto bus_it = buses_begin; bus_it != buses_end; ++bus_it) {
+        const Bus* bus = &*bus_it;
+        vector<const Stop*> stops = bus->Stops();
+        assert(stops.size() > 1);
+        if (bus->Linear()) {
+            // forward and then backward to the first stop
+            stops.insert(stops.end(), next(bus->Stops().rbegin()), bus->Stops().rend());
+        }
+        AddTrip(tc, bus, stops);
+    }
+
+    // group occurrences of stops in trips by stop
+    stop_trips_begin_.assign(stops_.size() + 1, 0);
+    for (const StopIndex stop : trip_stops_) {
+        ++stop_trips_begin_[stop + 1];
+    }
+    partial_sum(stop_trips_begin_.begin(), stop_trips_begin_.end(), stop_trips_begin_.begin());
+    stop_trips_.resize(trip_stops_.size());
+    vector<size_t> stop_trips_end(stop_trips_begin_.begin(), prev(stop_trips_begin_.end()));
+    for (TripIndex trip_index = 0; trip_index < trips_.size(); ++trip_index) {
+        const Trip& trip = trips_[trip_index];
+        for (size_t position = 0; position < trip.size; ++position) {
+            const StopIndex stop = trip_stops_[trip.first + position];
+            stop_trips_[stop_trips_end[stop]++] = {trip_index, position};
+        }
+    }
+}
+
+void RaptorRouter::AddTrip(const TransportCatalogue& tc, const Bus* bus,
+                           const vector<const Stop*>& stops) {
+    trips_.push_back({bus, trip_stops_.size(), stops.size()});
+    Distance distance = 0;
+    for (size_t position = 0; position < stops.size(); ++position) {
+        if (position > 0) {
+            distance += tc.GetDistance(stops[position - 1], stops[position]);
+        }
+        trip_stops_.push_back(stop_indices_.at(stops[position]));
+        trip_distances_.push_back(distance);
+    }
+}
+
+double RaptorRouter::RideTime(const Trip& trip, size_t board, size_t alight) const {
+    assert(board <= alight && alight < trip.size);
+    return (trip_distances_[trip.first + alight] - trip_distances_[trip.first + board])
+           / bus_velocity_;
+}
+
+optional<RaptorRouter::Journey> RaptorRouter::Route(const Stop* from, const Stop* to) const {
+    const StopIndex source = stop_indices_.at(from);
+    const StopIndex target = stop_indices_.at(to);
+    const Scan scan = RunRounds(source, target);
+    if (scan.best_times[target] == INFINITE_TIME) {
+        return nullopt;
+    }
+
+    Journey journey{scan.best_times[target], {}};
+    size_t round = scan.round_labels.size() - 1;
+    for (StopIndex stop = target; stop != source;) {
+        const Label& label = scan.round_labels[round][stop];
+        const Trip& trip = trips_[label.trip];
+        const StopIndex board_stop = trip_stops_[trip.first + label.board];
+        journey.legs.push_back({trip.bus, stops_[board_stop],
+                                static_cast<int>(label.alight - label.board),
+                                RideTime(trip, label.board, label.alight)});
+        stop = board_stop;
+        round = label.round - 1;
+    }
+    reverse(journey.legs.begin(), journey.legs.end());
+    return journey;
+}
+
+vector<optional<double>> RaptorRouter::Times(const Stop* from,
+                                             const vector<const Stop*>& targets) const {
+    const Scan scan = RunRounds(stop_indices_.at(from), nullopt);
+    vector<optional<double>> result;
+    result.reserve(targets.size());
+    for (const Stop* to : targets) {
+        const double time = scan.best_times[stop_indices_.at(to)];
+        result.push_back(time == INFINITE_TIME ? nullopt : optional<double>(time));
+    }
+    return result;
+}
+
+vector<pair<const Stop*, double>> RaptorRouter::Reachable(const Stop* from,
+                                                          double max_time) const {
+    const Scan scan = RunRounds(stop_indices_.at(from), nullopt, max_time);
+    vector<pair<const Stop*, double>> result;
+    for (StopIndex stop = 0; stop < stops_.size(); ++stop) {
+        if (scan.best_times[stop] <= max_time) {
+            result.push_back({stops_[stop], scan.best_times[stop]});
+        }
+    }
+    return result;
+}
+
+RaptorRouter::Scan RaptorRouter::RunRounds(StopIndex source, optional<StopIndex> target,
+                                           double max_time) const {
+    const size_t stop_count = stops_.size();
+
+    // best time over all rounds, time and label of every round
+    vector<double> best_times(stop_count, INFINITE_TIME);
+    vector<vector<double>> round_times{vector<double>(stop_count, INFINITE_TIME)};
+    vector<vector<Label>> round_labels{vector<Label>(stop_count)};
+    best_times[source] = 0;
+    round_times[0][source] = 0;
+
+    vector<StopIndex> marked_stops{source};
+    vector<bool> is_marked(stop_count, false);
+    vector<size_t> trip_starts(trips_.size(), NO_POSITION);
+    vector<TripIndex> queued_trips;
+
+    for (size_t round = 1; !marked_stops.empty(); ++round) {
+        // trips through stops improved in the previous round,
+        // every trip is scanned from the earliest such stop
+        for (const StopIndex stop : marked_stops) {
+            is_marked[stop] = false;
+            for (size_t i = stop_trips_begin_[stop]; i < stop_trips_begin_[stop + 1]; ++i) {
+                const StopTrip& stop_trip = stop_trips_[i];
+                size_t& start = trip_starts[stop_trip.trip];
+                if (start == NO_POSITION) {
+                    queued_trips.push_back(stop_trip.trip);
+                }
+                start = min(start, stop_trip.position);
+            }
+        }
+        marked_stops.clear();
+
+        round_times.push_back(round_times.back());
+        round_labels.push_back(round_labels.back());
+        const vector<double>& prev_times = round_times[round - 1];
+        vector<double>& times = round_times[round];
+        vector<Label>& labels = round_labels[round];
+
+        for (const TripIndex trip_index : queued_trips) {
+            const Trip& trip = trips_[trip_index];
+            size_t board = NO_POSITION;
+            double board_time = INFINITE_TIME;
+            for (size_t position = trip_starts[trip_index]; position < trip.size; ++position) {
+                const StopIndex stop = trip_stops_[trip.first + position];
+                double time = INFINITE_TIME;
+                if (board != NO_POSITION) {
+                    // get off the bus
+                    time = board_time + RideTime(trip, board, position);
+                    const double time_limit = target ? min(best_times[stop], best_times[*target])
+                                                     : best_times[stop];
+                    if (time < time_limit && time <= max_time) {
+                        best_times[stop] = time;
+                        times[stop] = time;
+                        labels[stop] = {round, trip_index, board, position};
+                        if (!is_marked[stop]) {
+                            is_marked[stop] = true;
+                            marked_stops.push_back(stop);
+                        }
+                    }
+                }
+                // get on the bus here if it is faster than to stay on it
+                if (prev_times[stop] != INFINITE_TIME
+                    && prev_times[stop] + bus_wait_time_ < time) {
+                    board = position;
+                    board_time = prev_times[stop] + bus_wait_time_;
+                }
+            }
+            trip_starts[trip_index] = NO_POSITION;
+        }
+        queued_trips.clear();
+    }
+
+    return {move(best_times), move(round_labels)};
+}
+
+} // namespace tcat::db
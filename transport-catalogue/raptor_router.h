@@ -0,0 +1,101 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tcat::db {
+
+// Round-based (RAPTOR-like) router over bus trips without routing graph.
+// Round k finds the fastest journeys with k boardings: every trip which goes through
+// a stop improved in round k-1 is scanned once from the earliest such stop.
+// Rounds go on while some stop is improved. Memory is proportional to the total number
+// of trip stops, trips and their cumulative distances are stored in contiguous arrays.
+class RaptorRouter {
+public:
+    // bus_wait_time in minutes, bus_velocity in meters per minute
+    RaptorRouter(const TransportCatalogue& tc, double bus_wait_time, double bus_velocity);
+
+    // wait for the bus at stop from, then ride span stops during ride_time minutes
+    struct Leg {
+        const Bus* bus;
+        const Stop* from;
+        int span;
+        double ride_time;
+    };
+
+    struct Journey {
+        double total_time;
+        std::vector<Leg> legs;
+    };
+
+    std::optional<Journey> Route(const Stop* from, const Stop* to) const;
+
+    // times of the fastest journeys from stop to every target, nullopt if there is no journey
+    std::vector<std::optional<double>> Times(const Stop* from,
+                                             const std::vector<const Stop*>& targets) const;
+
+    // stops reachable from stop not later than max_time with times of the fastest journeys
+    std::vector<std::pair<const Stop*, double>> Reachable(const Stop* from,
+                                                          double max_time) const;
+
+private:
+    using StopIndex = size_t;
+    using TripIndex = size_t;
+
+    // stops of trip i are trip_stops_[trips_[i].first .. trips_[i].first + trips_[i].size)
+    struct Trip {
+        const Bus* bus;
+        size_t first;
+        size_t size;
+    };
+
+    // occurrence of stop in trip
+    struct StopTrip {
+        TripIndex trip;
+        size_t position;
+    };
+
+    // how stop was reached in round: trip taken from board to alight position
+    struct Label {
+        size_t round;
+        TripIndex trip;
+        size_t board;
+        size_t alight;
+    };
+
+    // result of rounds: the best time of every stop and labels of every round
+    struct Scan {
+        std::vector<double> best_times;
+        std::vector<std::vector<Label>> round_labels;
+    };
+
+    // runs rounds from source, journeys slower than target (if any) or max_time are pruned
+    Scan RunRounds(StopIndex source, std::optional<StopIndex> target,
+                   double max_time = std::numeric_limits<double>::infinity()) const;
+
+    void AddTrip(const TransportCatalogue& tc, const Bus* bus,
+                 const std::vector<const Stop*>& stops);
+    double RideTime(const Trip& trip, size_t board, size_t alight) const;
+
+    const double bus_wait_time_;
+    const double bus_velocity_;
+
+    std::vector<const Stop*> stops_;
+    std::unordered_map<const Stop*, StopIndex> stop_indices_;
+
+    std::vector<Trip> trips_;
+    std::vector<StopIndex> trip_stops_;
+    std::vector<Distance> trip_distances_; // from the beginning of the trip
+
+    // trips of stop i are stop_trips_[stop_trips_begin_[i] .. stop_trips_begin_[i + 1])
+    std::vector<size_t> stop_trips_begin_;
+    std::vector<StopTrip> stop_trips_;
+};
+
+} // namespace tcat::db
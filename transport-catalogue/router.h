@@ -1,25 +1,39 @@
 #pragma once
 
 #include "graph.h"
+#include "min_plus.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
-template <typename Weight>
+template <typename Weight, typename Index = VertexId>
 class Router {
 public:
-    using Graph = DirectedWeightedGraph<Weight>;
+    using Graph = DirectedWeightedGraph<Weight, Index>;
 
-    explicit Router(const Graph& graph);
+    // Both methods fill the same tables, they may differ only in ties and rounding.
+    enum class BuildMethod {
+        FLOYD_WARSHALL, // blocked Floyd-Warshall for every component, O(n^3)
+        DIJKSTRA,       // Dijkstra search from every vertex in parallel, O(n * e * log n)
+    };
+
+    // tables are built by threads of thread_pool
+    Router(const Graph& graph, parallel::ThreadPool& thread_pool,
+           BuildMethod method = BuildMethod::FLOYD_WARSHALL);
 
     struct RouteInfo {
         Weight weight;
@@ -28,97 +42,519 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // edges of the route in order are written to edges, its storage is reused;
+    // returns weight of the route, nullopt if there is no route
+    std::optional<Weight> BuildRoute(VertexId from, VertexId to,
+                                     std::vector<EdgeId>& edges) const;
+
+    // calls visitor(edge_id) for edges of the route from the last one to the first one
+    // without allocations; returns weight of the route, nullopt if there is no route
+    template <typename Visitor>
+    std::optional<Weight> VisitRouteBackward(VertexId from, VertexId to,
+                                             Visitor&& visitor) const;
+
+    // weights of routes from every source to every target without routes themselves,
+    // row-major sources.size() * targets.size() matrix, nullopt if there is no route
+    std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+                                                    const std::vector<VertexId>& targets) const;
+
+    // vertices reachable from vertex by routes not heavier than max_weight with route weights
+    std::vector<std::pair<VertexId, Weight>> BuildReachable(VertexId from,
+                                                            Weight max_weight) const;
+
+    // Updates routes by edges [first_edge, edge count) added to the graph after the routes
+    // were built, the table grows by vertices added with them. Every edge u->v takes one
+    // O(V^2) pass: route a->b becomes a->u->v->b if it is lighter, rows a whose route to v
+    // isn't improved by the edge are skipped. Result equals the full rebuild up to ties.
+    void AddEdges(EdgeId first_edge, parallel::ThreadPool& thread_pool);
+
     // internal types for (de)serializatioin
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+    // Routes exist only inside weakly connected components of the graph, so every
+    // component has its own pair of row-major n * n tables (n is size of the component):
+    // weight of the best route (INFINITE_WEIGHT if there is no route) and
+    // last edge of the route (NO_EDGE for empty route). Tables of components follow each
+    // other in order of components, vertices of a component go in order of their ids.
+    using PrevEdge = min_plus::PrevEdge;
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                                  ? std::numeric_limits<Weight>::infinity()
+                                                  : std::numeric_limits<Weight>::max();
+    static constexpr PrevEdge NO_EDGE = min_plus::NO_EDGE;
+
+    struct RoutesInternalData {
+        size_t vertex_count = 0;
+        // component of every vertex, components are numbered in order of their first vertices
+        std::vector<uint32_t> components;
+        std::vector<Weight> weights;
+        std::vector<PrevEdge> prev_edges;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
-    // ctor with fileds for deserialization
+    // ctor with fileds for deserialization, empty components mean one component
     Router(const Graph& graph, RoutesInternalData&& data) :
-        graph_(graph), routes_internal_data_(std::move(data)) {}
+        graph_(graph), routes_internal_data_(std::move(data)) {
+        assert(routes_internal_data_.vertex_count == graph.GetVertexCount());
+        if (routes_internal_data_.components.empty()) {
+            routes_internal_data_.components.assign(routes_internal_data_.vertex_count, 0);
+        }
+        InitializeLayout();
+        assert(routes_internal_data_.weights.size() == Cells());
+        assert(routes_internal_data_.prev_edges.size() == Cells());
+    }
 
     // internal data for serialization
     const auto& InternalData() const { return routes_internal_data_; }
 
 private:
+    // weakly connected components numbered in order of their first vertices
+    static std::vector<uint32_t> FindComponents(const Graph& graph) {
+        const size_t vertex_count = graph.GetVertexCount();
+        constexpr uint32_t NO_COMPONENT = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> components(vertex_count, NO_COMPONENT);
+        uint32_t component_count = 0;
+        std::vector<VertexId> stack;
+        for (VertexId first = 0; first < vertex_count; ++first) {
+            if (components[first] != NO_COMPONENT) {
+                continue;
+            }
+            components[first] = component_count;
+            stack.push_back(first);
+            while (!stack.empty()) {
+                const VertexId vertex = stack.back();
+                stack.pop_back();
+                auto visit = [&](VertexId neighbour) {
+                    if (components[neighbour] == NO_COMPONENT) {
+                        components[neighbour] = component_count;
+                        stack.push_back(neighbour);
+                    }
+                };
+                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                    visit(graph.GetEdge(edge_id).to);
+                }
+                for (const EdgeId edge_id : graph.GetIncomingEdges(vertex)) {
+                    visit(graph.GetEdge(edge_id).from);
+                }
+            }
+            ++component_count;
+        }
+        return components;
+    }
+
+    // fills vertices of components, local indices and positions of tables by components
+    void InitializeLayout() {
+        const auto& components = routes_internal_data_.components;
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        assert(components.size() == vertex_count);
+        const size_t component_count =
+            components.empty() ? 0 : *std::max_element(components.begin(), components.end()) + 1;
+
+        component_begins_.assign(component_count + 1, 0);
+        for (const uint32_t component : components) {
+            ++component_begins_[component + 1];
+        }
+        table_begins_.assign(component_count + 1, 0);
+        for (size_t component = 0; component < component_count; ++component) {
+            const size_t size = component_begins_[component + 1];
+            table_begins_[component + 1] = table_begins_[component] + size * size;
+            component_begins_[component + 1] += component_begins_[component];
+        }
+
+        component_vertices_.resize(vertex_count);
+        local_indices_.resize(vertex_count);
+        std::vector<size_t> component_ends(component_begins_.begin(),
+                                           std::prev(component_begins_.end()));
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            const uint32_t component = components[vertex];
+            local_indices_[vertex] =
+                static_cast<uint32_t>(component_ends[component] - component_begins_[component]);
+            component_vertices_[component_ends[component]++] = vertex;
+        }
+    }
+
+    size_t ComponentSize(size_t component) const {
+        return component_begins_[component + 1] - component_begins_[component];
+    }
+
+    size_t Cells() const {
+        return table_begins_.back();
+    }
+
+    bool HasCell(VertexId from, VertexId to) const {
+        return routes_internal_data_.components[from] == routes_internal_data_.components[to];
+    }
+
+    // from and to must be in the same component
+    size_t Cell(VertexId from, VertexId to) const {
+        assert(HasCell(from, to));
+        const uint32_t component = routes_internal_data_.components[from];
+        return table_begins_[component]
+               + local_indices_[from] * ComponentSize(component) + local_indices_[to];
+    }
+
     void InitializeRoutesInternalData(const Graph& graph) {
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for route table");
+        }
         const size_t vertex_count = graph.GetVertexCount();
+        auto& weights = routes_internal_data_.weights;
+        auto& prev_edges = routes_internal_data_.prev_edges;
+        routes_internal_data_.vertex_count = vertex_count;
+        routes_internal_data_.components = FindComponents(graph);
+        InitializeLayout();
+        weights.assign(Cells(), INFINITE_WEIGHT);
+        prev_edges.assign(Cells(), NO_EDGE);
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            weights[Cell(vertex, vertex)] = ZERO_WEIGHT;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t cell = Cell(vertex, edge.to);
+                if (weights[cell] > edge.weight) {
+                    weights[cell] = edge.weight;
+                    prev_edges[cell] = static_cast<PrevEdge>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Tables of components are relaxed independently. Components of one tile are relaxed
+    // in parallel, then larger components one by one with parallel tiles.
+    void RelaxRoutesInternalData(parallel::ThreadPool& thread_pool) {
+        std::vector<size_t> small_components;
+        for (size_t component = 0; component + 1 < table_begins_.size(); ++component) {
+            const size_t size = ComponentSize(component);
+            if (size <= 1) {
+                continue;
+            } else if (size <= BLOCK_SIZE) {
+                small_components.push_back(component);
+            } else {
+                RelaxTable(component, &thread_pool);
+            }
         }
+        thread_pool.ParallelFor(small_components.size(), [&](size_t index) {
+            RelaxTable(small_components[index], nullptr);
+        });
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
+    // Blocked Floyd-Warshall over table of the component. Vertices are split into blocks
+    // of BLOCK_SIZE and the table into tiles. For every block of intermediate vertices
+    // tiles are relaxed in three phases: the diagonal tile, then tiles of its row and column,
+    // then all other tiles. Tiles of one phase are independent and relaxed in parallel
+    // if thread_pool isn't null.
+    void RelaxTable(size_t component, parallel::ThreadPool* thread_pool) {
+        const size_t size = ComponentSize(component);
+        Weight* weights = routes_internal_data_.weights.data() + table_begins_[component];
+        PrevEdge* prev_edges = routes_internal_data_.prev_edges.data() + table_begins_[component];
+        auto parallel_for = [thread_pool](size_t count, const auto& func) {
+            if (thread_pool) {
+                thread_pool->ParallelFor(count, func);
+            } else {
+                for (size_t index = 0; index < count; ++index) {
+                    func(index);
                 }
             }
+        };
+
+        const size_t block_count = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (size_t block_through = 0; block_through < block_count; ++block_through) {
+            RelaxTile(weights, prev_edges, size, block_through, block_through, block_through);
+
+            // tiles (block_through, i) and (i, block_through) for i != block_through
+            parallel_for(2 * block_count, [&](size_t index) {
+                const size_t block = index / 2;
+                if (block == block_through) {
+                    return;
+                }
+                if (index % 2 == 0) {
+                    RelaxTile(weights, prev_edges, size, block_through, block, block_through);
+                } else {
+                    RelaxTile(weights, prev_edges, size, block, block_through, block_through);
+                }
+            });
+
+            // other tiles
+            parallel_for(block_count * block_count, [&](size_t index) {
+                const size_t block_from = index / block_count;
+                const size_t block_to = index % block_count;
+                if (block_from == block_through || block_to == block_through) {
+                    return;
+                }
+                RelaxTile(weights, prev_edges, size, block_from, block_to, block_through);
+            });
         }
     }
 
+    // tile of table size * size, vertices are local indices
+    static void RelaxTile(Weight* weights, PrevEdge* prev_edges, size_t size,
+                          size_t block_from, size_t block_to, size_t block_through) {
+        const auto [from_begin, from_end] = BlockRange(size, block_from);
+        const auto [to_begin, to_end] = BlockRange(size, block_to);
+        const auto [through_begin, through_end] = BlockRange(size, block_through);
+        for (size_t vertex_through = through_begin; vertex_through < through_end;
+             ++vertex_through) {
+            const size_t row_through = vertex_through * size;
+            for (size_t vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+                const size_t row_from = vertex_from * size;
+                const size_t cell_from = row_from + vertex_through;
+                const Weight weight_from = weights[cell_from];
+                if (weight_from == INFINITE_WEIGHT) {
+                    continue;
+                }
+                RelaxRow(weight_from, prev_edges[cell_from],
+                         weights + row_through + to_begin, prev_edges + row_through + to_begin,
+                         weights + row_from + to_begin, prev_edges + row_from + to_begin,
+                         to_end - to_begin);
+            }
+        }
+    }
+
+    // Rows of sources are independent, the pool hands them out to free threads one by one.
+    // Every search writes tentative weights right into the row of the source.
+    void SearchRoutesInternalData(parallel::ThreadPool& thread_pool) {
+        thread_pool.ParallelFor(routes_internal_data_.vertex_count, [this](size_t from) {
+            SearchRoutes(from);
+        });
+    }
+
+    void SearchRoutes(VertexId from) {
+        const uint32_t component = routes_internal_data_.components[from];
+        const size_t size = ComponentSize(component);
+        const VertexId first_vertex = component_vertices_[component_begins_[component]];
+        Weight* weights = &routes_internal_data_.weights[Cell(from, first_vertex)];
+        PrevEdge* prev_edges = &routes_internal_data_.prev_edges[Cell(from, first_vertex)];
+        std::fill(weights, weights + size, INFINITE_WEIGHT);
+        std::fill(prev_edges, prev_edges + size, NO_EDGE);
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        weights[local_indices_[from]] = ZERO_WEIGHT;
+        queue.push({ZERO_WEIGHT, from});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[local_indices_[vertex]]) {
+                continue; // outdated item
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = weight + edge.weight;
+                const uint32_t to = local_indices_[edge.to];
+                if (candidate_weight < weights[to]) {
+                    weights[to] = candidate_weight;
+                    prev_edges[to] = static_cast<PrevEdge>(edge_id);
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+    }
+
+    // relax routes weights[i] by weight_from + weights_through[i] for i < count,
+    // double weights are relaxed by vectorized kernel, see min_plus.h
+    static void RelaxRow(Weight weight_from, PrevEdge prev_edge_from,
+                         const Weight* weights_through, const PrevEdge* prev_edges_through,
+                         Weight* weights, PrevEdge* prev_edges, size_t count) {
+        if constexpr (std::is_same_v<Weight, double>) {
+            min_plus::RelaxRow(weight_from, prev_edge_from, weights_through, prev_edges_through,
+                               weights, prev_edges, count);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (weights_through[i] == INFINITE_WEIGHT) {
+                continue;
+            }
+            const Weight candidate_weight = weight_from + weights_through[i];
+            if (candidate_weight < weights[i]) {
+                weights[i] = candidate_weight;
+                prev_edges[i] = prev_edges_through[i] != NO_EDGE ? prev_edges_through[i]
+                                                                 : prev_edge_from;
+            }
+        }
+    }
+
+    // Moves routes to tables of new components. Edges only join components, so routes
+    // of every old component go to one new component. New vertices have no routes yet.
+    void UpdateComponents(std::vector<uint32_t>&& components) {
+        const RoutesInternalData old_data = std::move(routes_internal_data_);
+        const std::vector<size_t> old_component_begins = std::move(component_begins_);
+        const std::vector<VertexId> old_component_vertices = std::move(component_vertices_);
+        const std::vector<size_t> old_table_begins = std::move(table_begins_);
+
+        routes_internal_data_ = RoutesInternalData{};
+        routes_internal_data_.vertex_count = components.size();
+        routes_internal_data_.components = std::move(components);
+        InitializeLayout();
+        auto& weights = routes_internal_data_.weights;
+        auto& prev_edges = routes_internal_data_.prev_edges;
+        weights.assign(Cells(), INFINITE_WEIGHT);
+        prev_edges.assign(Cells(), NO_EDGE);
+        for (VertexId vertex = 0; vertex < routes_internal_data_.vertex_count; ++vertex) {
+            weights[Cell(vertex, vertex)] = ZERO_WEIGHT;
+        }
+        for (size_t component = 0; component + 1 < old_table_begins.size(); ++component) {
+            const VertexId* vertices = &old_component_vertices[old_component_begins[component]];
+            const size_t size = old_component_begins[component + 1]
+                                - old_component_begins[component];
+            size_t old_cell = old_table_begins[component];
+            for (size_t from = 0; from < size; ++from) {
+                for (size_t to = 0; to < size; ++to, ++old_cell) {
+                    const size_t cell = Cell(vertices[from], vertices[to]);
+                    weights[cell] = old_data.weights[old_cell];
+                    prev_edges[cell] = old_data.prev_edges[old_cell];
+                }
+            }
+        }
+    }
+
+    // relax all routes by the edge, routes to edge.from and from edge.to don't change
+    void RelaxEdge(EdgeId edge_id, parallel::ThreadPool& thread_pool) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        const uint32_t component = routes_internal_data_.components[edge.from];
+        const size_t size = ComponentSize(component);
+        const VertexId* vertices = &component_vertices_[component_begins_[component]];
+        Weight* weights = routes_internal_data_.weights.data();
+        PrevEdge* prev_edges = routes_internal_data_.prev_edges.data();
+        const size_t row_through = Cell(edge.to, vertices[0]);
+        thread_pool.ParallelFor(size, [&](size_t index) {
+            const VertexId vertex_from = vertices[index];
+            const Weight weight_from = weights[Cell(vertex_from, edge.from)];
+            if (weight_from == INFINITE_WEIGHT) {
+                return;
+            }
+            // route to edge.to isn't improved, so neither are routes through it
+            const Weight weight_through = weight_from + edge.weight;
+            if (!(weight_through < weights[Cell(vertex_from, edge.to)])) {
+                return;
+            }
+            const size_t row_from = Cell(vertex_from, vertices[0]);
+            RelaxRow(weight_through, static_cast<PrevEdge>(edge_id),
+                     weights + row_through, prev_edges + row_through,
+                     weights + row_from, prev_edges + row_from, size);
+        });
+    }
+
+    static std::pair<size_t, size_t> BlockRange(size_t size, size_t block) {
+        return {block * BLOCK_SIZE, std::min(size, (block + 1) * BLOCK_SIZE)};
+    }
+
+    static constexpr size_t BLOCK_SIZE = 64;
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
     RoutesInternalData routes_internal_data_;
+
+    // vertices of component i are component_vertices_[component_begins_[i] ..
+    // component_begins_[i + 1]), its table starts at table_begins_[i]
+    std::vector<size_t> component_begins_;
+    std::vector<VertexId> component_vertices_;
+    std::vector<uint32_t> local_indices_; // index of vertex in its component
+    std::vector<size_t> table_begins_;
 };
 
-template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+template <typename Weight, typename Index>
+Router<Weight, Index>::Router(const Graph& graph, parallel::ThreadPool& thread_pool,
+                              BuildMethod method)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
     InitializeRoutesInternalData(graph);
+    switch (method) {
+        case BuildMethod::FLOYD_WARSHALL:
+            RelaxRoutesInternalData(thread_pool);
+            break;
+        case BuildMethod::DIJKSTRA:
+            SearchRoutesInternalData(thread_pool);
+            break;
+    }
+}
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+template <typename Weight, typename Index>
+void Router<Weight, Index>::AddEdges(EdgeId first_edge, parallel::ThreadPool& thread_pool) {
+    if (graph_.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for route table");
+    }
+    auto components = FindComponents(graph_);
+    if (components != routes_internal_data_.components) {
+        UpdateComponents(std::move(components));
+    }
+    for (EdgeId edge_id = first_edge; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        RelaxEdge(edge_id, thread_pool);
     }
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_[from][to];
-    if (!route_internal_data) {
+template <typename Weight, typename Index>
+std::optional<typename Router<Weight, Index>::RouteInfo>
+Router<Weight, Index>::BuildRoute(VertexId from, VertexId to) const {
+    std::vector<EdgeId> edges;
+    const auto weight = BuildRoute(from, to, edges);
+    if (!weight) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
-    std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    return RouteInfo{*weight, std::move(edges)};
+}
+
+template <typename Weight, typename Index>
+std::optional<Weight> Router<Weight, Index>::BuildRoute(VertexId from, VertexId to,
+                                                        std::vector<EdgeId>& edges) const {
+    edges.clear();
+    const auto weight = VisitRouteBackward(from, to, [&edges](EdgeId edge_id) {
+        edges.push_back(edge_id);
+    });
+    std::reverse(edges.begin(), edges.end());
+    return weight;
+}
+
+template <typename Weight, typename Index>
+template <typename Visitor>
+std::optional<Weight> Router<Weight, Index>::VisitRouteBackward(VertexId from, VertexId to,
+                                                                Visitor&& visitor) const {
+    if (!HasCell(from, to)) {
+        return std::nullopt;
+    }
+    const Weight weight = routes_internal_data_.weights[Cell(from, to)];
+    if (weight == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+    const auto& prev_edges = routes_internal_data_.prev_edges;
+    for (PrevEdge edge_id = prev_edges[Cell(from, to)];
+         edge_id != NO_EDGE;
+         edge_id = prev_edges[Cell(from, graph_.GetEdge(edge_id).from)])
     {
-        edges.push_back(*edge_id);
+        visitor(static_cast<EdgeId>(edge_id));
     }
-    std::reverse(edges.begin(), edges.end());
+    return weight;
+}
 
-    return RouteInfo{weight, std::move(edges)};
+template <typename Weight, typename Index>
+std::vector<std::optional<Weight>>
+Router<Weight, Index>::BuildWeights(const std::vector<VertexId>& sources,
+                                    const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<Weight>> result;
+    result.reserve(sources.size() * targets.size());
+    for (const VertexId from : sources) {
+        for (const VertexId to : targets) {
+            const Weight weight = HasCell(from, to) ? routes_internal_data_.weights[Cell(from, to)]
+                                                    : INFINITE_WEIGHT;
+            result.push_back(weight == INFINITE_WEIGHT ? std::nullopt
+                                                       : std::optional<Weight>(weight));
+        }
+    }
+    return result;
+}
+
+template <typename Weight, typename Index>
+std::vector<std::pair<VertexId, Weight>>
+Router<Weight, Index>::BuildReachable(VertexId from, Weight max_weight) const {
+    std::vector<std::pair<VertexId, Weight>> result;
+    const uint32_t component = routes_internal_data_.components[from];
+    const VertexId* vertices = &component_vertices_[component_begins_[component]];
+    const Weight* row = &routes_internal_data_.weights[Cell(from, vertices[0])];
+    for (size_t index = 0; index < ComponentSize(component); ++index) {
+        if (row[index] <= max_weight) {
+            result.push_back({vertices[index], row[index]});
+        }
+    }
+    return result;
 }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
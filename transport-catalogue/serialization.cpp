@@ -9,8 +9,12 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <stdexcept>
+#include <utility>
 
 #include <transport_catalogue.pb.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
 
 
 namespace tcat::io::serialization {
@@ -125,6 +129,51 @@ void FillMessage(const io::MapRendererSettings& settings, proto::RenderSettings&
 void FillMessage(const db::RoutingSettings& settings, proto::RoutingSettings& message) {
     message.set_bus_wait_time(settings.bus_wait_time);
     message.set_bus_velocity(settings.bus_velocity);
+    message.set_landmark_count(settings.landmark_count);
+    message.set_route_cache_size(settings.route_cache_size);
+    message.set_parallel_search_min_vertices(settings.parallel_search_min_vertices);
+    switch (settings.router) {
+        case db::RouterType::ALL_PAIRS:
+            message.set_router(proto::RoutingSettings_RouterType_ALL_PAIRS);
+            break;
+        case db::RouterType::DIJKSTRA:
+            message.set_router(proto::RoutingSettings_RouterType_DIJKSTRA);
+            break;
+        case db::RouterType::CONTRACTION_HIERARCHIES:
+            message.set_router(proto::RoutingSettings_RouterType_CONTRACTION_HIERARCHIES);
+            break;
+        case db::RouterType::ASTAR:
+            message.set_router(proto::RoutingSettings_RouterType_ASTAR);
+            break;
+        case db::RouterType::ALT:
+            message.set_router(proto::RoutingSettings_RouterType_ALT);
+            break;
+        case db::RouterType::BIDIRECTIONAL_DIJKSTRA:
+            message.set_router(proto::RoutingSettings_RouterType_BIDIRECTIONAL_DIJKSTRA);
+            break;
+        case db::RouterType::RAPTOR:
+            message.set_router(proto::RoutingSettings_RouterType_RAPTOR);
+            break;
+        case db::RouterType::HUB_LABELS:
+            message.set_router(proto::RoutingSettings_RouterType_HUB_LABELS);
+            break;
+    }
+    switch (settings.graph_model) {
+        case db::GraphModel::STOP_PAIRS:
+            message.set_graph_model(proto::RoutingSettings_GraphModel_STOP_PAIRS);
+            break;
+        case db::GraphModel::WAIT_AND_RIDE:
+            message.set_graph_model(proto::RoutingSettings_GraphModel_WAIT_AND_RIDE);
+            break;
+    }
+    switch (settings.vertex_order) {
+        case db::VertexOrder::STOPS:
+            message.set_vertex_order(proto::RoutingSettings_VertexOrder_STOPS);
+            break;
+        case db::VertexOrder::HILBERT:
+            message.set_vertex_order(proto::RoutingSettings_VertexOrder_HILBERT);
+            break;
+    }
 }
 
 void FillMessage(const db::TransportRouter::Graph& graph, proto::Graph& message) {
@@ -141,31 +190,92 @@ void FillMessage(const db::TransportRouter::Graph& graph, proto::Graph& message)
 
 void FillMessage(const db::TransportRouter::Router& router, proto::Router& message) {
     const auto& internal_data = router.InternalData();
-    for (const auto& data_row : internal_data) {
-        auto& data_row_msg = *message.add_data_row();
-        for (const auto& data : data_row) {
-            auto& opt_data = *data_row_msg.add_opt_data();
-            if (data.has_value()) {
-                auto& data_msg = *opt_data.add_data();        // optional<RouteInternalData>
-                data_msg.set_weight(data->weight);
-                if (data->prev_edge.has_value()) {
-                    data_msg.add_prev_edge(*data->prev_edge); // optional<EdgeId> prev_edge
-                }
-            }
-        }
+    message.set_vertex_count(internal_data.vertex_count);
+    message.mutable_weight()->Add(internal_data.weights.begin(), internal_data.weights.end());
+    message.mutable_prev_edge()->Add(internal_data.prev_edges.begin(),
+                                     internal_data.prev_edges.end());
+    message.mutable_component()->Add(internal_data.components.begin(),
+                                     internal_data.components.end());
+}
+
+void FillMessage(const db::TransportRouter::ContractionHierarchy& hierarchy,
+                 proto::ContractionHierarchy& message) {
+    const auto& internal_data = hierarchy.InternalData();
+    message.mutable_rank()->Add(internal_data.ranks.begin(), internal_data.ranks.end());
+    for (const auto& shortcut : internal_data.shortcuts) {
+        auto& shortcut_msg = *message.add_shortcut();
+        shortcut_msg.set_from(shortcut.from);
+        shortcut_msg.set_to(shortcut.to);
+        shortcut_msg.set_weight(shortcut.weight);
+        shortcut_msg.set_first_arc(shortcut.first_arc);
+        shortcut_msg.set_second_arc(shortcut.second_arc);
+    }
+}
+
+void FillMessage(const db::TransportRouter::Landmarks& landmarks, proto::Landmarks& message) {
+    const auto& internal_data = landmarks.InternalData();
+    message.set_vertex_count(internal_data.vertex_count);
+    message.mutable_landmark()->Add(internal_data.landmarks.begin(),
+                                    internal_data.landmarks.end());
+    message.mutable_from_landmark()->Add(internal_data.from_landmark.begin(),
+                                         internal_data.from_landmark.end());
+    message.mutable_to_landmark()->Add(internal_data.to_landmark.begin(),
+                                       internal_data.to_landmark.end());
+}
+
+void FillMessage(const db::TransportRouter::HubLabels::Labels& labels,
+                 proto::HubLabels::Labels& message) {
+    message.mutable_offset()->Add(labels.offsets.begin(), labels.offsets.end());
+    message.mutable_hub()->Reserve(labels.entries.size());
+    message.mutable_edge()->Reserve(labels.entries.size());
+    message.mutable_weight()->Reserve(labels.entries.size());
+    for (const auto& entry : labels.entries) {
+        message.add_hub(entry.hub);
+        message.add_edge(entry.edge);
+        message.add_weight(entry.weight);
     }
 }
 
+void FillMessage(const db::TransportRouter::HubLabels& hub_labels, proto::HubLabels& message) {
+    const auto& internal_data = hub_labels.InternalData();
+    message.mutable_order()->Add(internal_data.order.begin(), internal_data.order.end());
+    FillMessage(internal_data.forward, *message.mutable_forward());
+    FillMessage(internal_data.backward, *message.mutable_backward());
+}
+
 void FillMessage(const db::TransportRouter& router, proto::TransportRouter& message) {
     // Graph
     FillMessage(router.InternalGraph(), *message.mutable_graph());
 
     // Router
-    FillMessage(router.InternalRouter(), *message.mutable_router());
+    if (router.InternalRouter()) {
+        FillMessage(*router.InternalRouter(), *message.mutable_router());
+    }
 
-    // StopVertices stop_vertices_
+    // ContractionHierarchy
+    if (router.InternalContractionHierarchy()) {
+        FillMessage(*router.InternalContractionHierarchy(),
+                    *message.mutable_contraction_hierarchy());
+    }
+
+    // Landmarks
+    if (router.InternalLandmarks()) {
+        FillMessage(*router.InternalLandmarks(), *message.mutable_landmarks());
+    }
+
+    // HubLabels
+    if (router.InternalHubLabels()) {
+        FillMessage(*router.InternalHubLabels(), *message.mutable_hub_labels());
+    }
+
+    // StopVertices stop_vertices_, stops added by TransportRouter::AddBus may follow
+    // other vertices, which get 0
     const auto& stop_to_vertex = router.InternalStopToVertex();
-    message.mutable_vertex_to_stop_id()->Resize(stop_to_vertex.size(), 0);
+    graph::VertexId vertex_count = 0;
+    for (const auto& stop_vertex : stop_to_vertex) {
+        vertex_count = max(vertex_count, stop_vertex.second + 1);
+    }
+    message.mutable_vertex_to_stop_id()->Resize(vertex_count, 0);
     for (const auto& stop_vertex : router.InternalStopToVertex()) {
         message.set_vertex_to_stop_id(stop_vertex.second,
                                       reinterpret_cast<uint64_t>(stop_vertex.first));
@@ -187,14 +297,20 @@ void FillMessage(const Base& base, proto::Base& base_msg) {
     FillMessage(base.transport_catalogue, *base_msg.mutable_transport_catalogue());
     FillMessage(base.render_settings, *base_msg.mutable_render_settings());
     FillMessage(base.routing_settings, *base_msg.mutable_routing_settings());
-    assert(base.transport_router);
-    FillMessage(*base.transport_router, *base_msg.mutable_transport_router());
 }
 
 bool Serialize(const Base& base, std::ostream& output) {
     proto::Base base_msg;
     FillMessage(base, base_msg);
-    bool success = base_msg.SerializeToOstream(&output);
+    assert(base.transport_router);
+    proto::TransportRouter transport_router_msg;
+    FillMessage(*base.transport_router, transport_router_msg);
+
+    google::protobuf::io::OstreamOutputStream raw_output(&output);
+    google::protobuf::io::CodedOutputStream coded_output(&raw_output);
+    coded_output.WriteVarint64(base_msg.ByteSizeLong());
+    bool success = base_msg.SerializeToCodedStream(&coded_output)
+                   && transport_router_msg.SerializeToCodedStream(&coded_output);
     return success;
 }
 
@@ -292,68 +408,174 @@ void Parse(const proto::RoutingSettings& message, db::RoutingSettings& settings)
     assert(message.bus_velocity() > 0);
     settings.bus_wait_time = message.bus_wait_time();
     settings.bus_velocity = message.bus_velocity();
+    settings.landmark_count = message.landmark_count();
+    settings.route_cache_size = message.route_cache_size();
+    settings.parallel_search_min_vertices = message.parallel_search_min_vertices();
+    switch (message.router()) {
+        case proto::RoutingSettings_RouterType_DIJKSTRA:
+            settings.router = db::RouterType::DIJKSTRA;
+            break;
+        case proto::RoutingSettings_RouterType_CONTRACTION_HIERARCHIES:
+            settings.router = db::RouterType::CONTRACTION_HIERARCHIES;
+            break;
+        case proto::RoutingSettings_RouterType_ASTAR:
+            settings.router = db::RouterType::ASTAR;
+            break;
+        case proto::RoutingSettings_RouterType_ALT:
+            settings.router = db::RouterType::ALT;
+            break;
+        case proto::RoutingSettings_RouterType_BIDIRECTIONAL_DIJKSTRA:
+            settings.router = db::RouterType::BIDIRECTIONAL_DIJKSTRA;
+            break;
+        case proto::RoutingSettings_RouterType_RAPTOR:
+            settings.router = db::RouterType::RAPTOR;
+            break;
+        case proto::RoutingSettings_RouterType_HUB_LABELS:
+            settings.router = db::RouterType::HUB_LABELS;
+            break;
+        default:
+            settings.router = db::RouterType::ALL_PAIRS;
+            break;
+    }
+    switch (message.graph_model()) {
+        case proto::RoutingSettings_GraphModel_WAIT_AND_RIDE:
+            settings.graph_model = db::GraphModel::WAIT_AND_RIDE;
+            break;
+        default:
+            settings.graph_model = db::GraphModel::STOP_PAIRS;
+            break;
+    }
+    switch (message.vertex_order()) {
+        case proto::RoutingSettings_VertexOrder_HILBERT:
+            settings.vertex_order = db::VertexOrder::HILBERT;
+            break;
+        default:
+            settings.vertex_order = db::VertexOrder::STOPS;
+            break;
+    }
 }
 
 unique_ptr<db::TransportRouter::Graph>
 Parse(const proto::Graph& graph_msg) {
-    auto graph_ptr = make_unique<db::TransportRouter::Graph>(graph_msg.vertex_count());
-    auto& graph = *graph_ptr;
+    using Index = db::TransportRouter::Index;
+    const size_t vertex_count = graph_msg.vertex_count();
+    vector<db::TransportRouter::Edge> edges;
+    edges.reserve(graph_msg.edge_size());
     for (const auto& edge_msg : graph_msg.edge()) {
-        graph.AddEdge({edge_msg.from(), edge_msg.to(), edge_msg.weight()});
+        assert(edge_msg.from() < vertex_count && edge_msg.to() < vertex_count);
+        edges.push_back({static_cast<Index>(edge_msg.from()), static_cast<Index>(edge_msg.to()),
+                         edge_msg.weight()});
     }
-    assert(graph.GetEdgeCount() == graph_msg.edge_size());
-    return graph_ptr;
+    // the graph is frozen as a built one
+    return make_unique<db::TransportRouter::Graph>(vertex_count, move(edges));
 }
 
 unique_ptr<db::TransportRouter::Router>
 Parse(const proto::Router& router_msg, const db::TransportRouter::Graph& graph) {
 
     using RoutesInternalData = db::TransportRouter::Router::RoutesInternalData;
-    using RouteInternalData = db::TransportRouter::Router::RouteInternalData;
 
-    size_t vertex_count = router_msg.data_row_size();
+    const size_t vertex_count = router_msg.vertex_count();
     assert(vertex_count == graph.GetVertexCount());
-    RoutesInternalData internal_data{vertex_count,
-                                     std::vector<std::optional<RouteInternalData>>(vertex_count)};
-    size_t i1 = 0;
-    for (const auto& data_row_msg : router_msg.data_row()) {
-        assert(data_row_msg.opt_data_size() == vertex_count); // must be N*N
-        size_t i2 = 0;
-        for (const auto& opt_data_msg : data_row_msg.opt_data()) {
-            if (opt_data_msg.data_size() > 0) {
-                // has value
-                assert(opt_data_msg.data_size() == 1);
-                const auto& data_msg = opt_data_msg.data(0);
-                RouteInternalData data;
-                data.weight = data_msg.weight();
-                if (data_msg.prev_edge_size() > 0) {
-                    assert(data_msg.prev_edge_size() == 1);
-                    data.prev_edge = data_msg.prev_edge(0);
-                } else {
-                    assert(!data.prev_edge.has_value());
-                }
-                internal_data[i1][i2] = std::move(data);
-            }
-            ++i2;
-        }
-        ++i1;
-    }
+    assert(router_msg.component_size() == 0 || router_msg.component_size() == vertex_count);
+    RoutesInternalData internal_data;
+    internal_data.vertex_count = vertex_count;
+    internal_data.components.assign(router_msg.component().begin(), router_msg.component().end());
+    internal_data.weights.assign(router_msg.weight().begin(), router_msg.weight().end());
+    internal_data.prev_edges.assign(router_msg.prev_edge().begin(), router_msg.prev_edge().end());
     return make_unique<db::TransportRouter::Router>(graph, std::move(internal_data));
 }
 
+unique_ptr<db::TransportRouter::ContractionHierarchy>
+Parse(const proto::ContractionHierarchy& hierarchy_msg, const db::TransportRouter::Graph& graph) {
+    using HierarchyInternalData = db::TransportRouter::ContractionHierarchy::HierarchyInternalData;
+
+    assert(hierarchy_msg.rank_size() == graph.GetVertexCount());
+    HierarchyInternalData internal_data;
+    internal_data.ranks.assign(hierarchy_msg.rank().begin(), hierarchy_msg.rank().end());
+    internal_data.shortcuts.reserve(hierarchy_msg.shortcut_size());
+    for (const auto& shortcut_msg : hierarchy_msg.shortcut()) {
+        internal_data.shortcuts.push_back({shortcut_msg.from(), shortcut_msg.to(),
+                                           shortcut_msg.weight(), shortcut_msg.first_arc(),
+                                           shortcut_msg.second_arc()});
+    }
+    return make_unique<db::TransportRouter::ContractionHierarchy>(graph, std::move(internal_data));
+}
+
+unique_ptr<db::TransportRouter::Landmarks>
+Parse(const proto::Landmarks& landmarks_msg, const db::TransportRouter::Graph& graph) {
+    using LandmarksInternalData = db::TransportRouter::Landmarks::LandmarksInternalData;
+
+    const size_t vertex_count = landmarks_msg.vertex_count();
+    assert(vertex_count == graph.GetVertexCount());
+    assert(landmarks_msg.from_landmark_size() == landmarks_msg.landmark_size() * vertex_count);
+    assert(landmarks_msg.to_landmark_size() == landmarks_msg.landmark_size() * vertex_count);
+    LandmarksInternalData internal_data;
+    internal_data.vertex_count = vertex_count;
+    internal_data.landmarks.assign(landmarks_msg.landmark().begin(),
+                                   landmarks_msg.landmark().end());
+    internal_data.from_landmark.assign(landmarks_msg.from_landmark().begin(),
+                                       landmarks_msg.from_landmark().end());
+    internal_data.to_landmark.assign(landmarks_msg.to_landmark().begin(),
+                                     landmarks_msg.to_landmark().end());
+    return make_unique<db::TransportRouter::Landmarks>(graph, std::move(internal_data));
+}
+
+db::TransportRouter::HubLabels::Labels Parse(const proto::HubLabels::Labels& labels_msg) {
+    db::TransportRouter::HubLabels::Labels labels;
+    assert(labels_msg.edge_size() == labels_msg.hub_size());
+    assert(labels_msg.weight_size() == labels_msg.hub_size());
+    labels.offsets.assign(labels_msg.offset().begin(), labels_msg.offset().end());
+    labels.entries.reserve(labels_msg.hub_size());
+    for (int index = 0; index < labels_msg.hub_size(); ++index) {
+        labels.entries.push_back({labels_msg.hub(index), labels_msg.edge(index),
+                                  labels_msg.weight(index)});
+    }
+    return labels;
+}
+
+unique_ptr<db::TransportRouter::HubLabels>
+Parse(const proto::HubLabels& hub_labels_msg, const db::TransportRouter::Graph& graph) {
+    using HubLabelsInternalData = db::TransportRouter::HubLabels::HubLabelsInternalData;
+
+    assert(hub_labels_msg.order_size() == graph.GetVertexCount());
+    HubLabelsInternalData internal_data;
+    internal_data.order.assign(hub_labels_msg.order().begin(), hub_labels_msg.order().end());
+    internal_data.forward = Parse(hub_labels_msg.forward());
+    internal_data.backward = Parse(hub_labels_msg.backward());
+    return make_unique<db::TransportRouter::HubLabels>(graph, std::move(internal_data));
+}
+
 unique_ptr<db::TransportRouter> Parse(const db::TransportCatalogue& tc,
 db::RoutingSettings settings,
 const StopIdMap& id_to_stop, const BusIdMap& id_to_bus,
 const proto::TransportRouter& transport_router_msg) {
 
     auto graph = Parse(transport_router_msg.graph());
-    auto router = Parse(transport_router_msg.router(), *graph);
+    unique_ptr<db::TransportRouter::Router> router;
+    if (transport_router_msg.has_router()) {
+        router = Parse(transport_router_msg.router(), *graph);
+    }
+    unique_ptr<db::TransportRouter::ContractionHierarchy> contraction_hierarchy;
+    if (transport_router_msg.has_contraction_hierarchy()) {
+        contraction_hierarchy = Parse(transport_router_msg.contraction_hierarchy(), *graph);
+    }
+    unique_ptr<db::TransportRouter::Landmarks> landmarks;
+    if (transport_router_msg.has_landmarks()) {
+        landmarks = Parse(transport_router_msg.landmarks(), *graph);
+    }
+    unique_ptr<db::TransportRouter::HubLabels> hub_labels;
+    if (transport_router_msg.has_hub_labels()) {
+        hub_labels = Parse(transport_router_msg.hub_labels(), *graph);
+    }
 
     db::TransportRouter::StopVertices stop_vertices; // Stop* to vertix id
     int vertex_id = 0;
     for (const auto stop_id : transport_router_msg.vertex_to_stop_id()) {
-        const Stop* stop = id_to_stop.at(stop_id);
-        stop_vertices[stop] = vertex_id;
+        if (stop_id != 0) {
+            const Stop* stop = id_to_stop.at(stop_id);
+            stop_vertices[stop] = vertex_id;
+        }
         ++vertex_id;
     }
 
@@ -369,15 +591,37 @@ const proto::TransportRouter& transport_router_msg) {
     }
 
     return make_unique<db::TransportRouter>(tc, move(settings), move(graph), move(router),
-    move(stop_vertices), move(edges));
+    move(contraction_hierarchy), move(landmarks), move(hub_labels), move(stop_vertices),
+    move(edges));
 }
 
 bool Deserialize(std::istream& input, Base& base) {
-    proto::Base base_msg;
-    bool success = base_msg.ParseFromIstream(&input);
-    assert(success);
-    if (!success)
+    RouterLoader router_loader = DeserializeLazy(input, base);
+    if (!router_loader)
         return false;
+    router_loader();
+    return true;
+}
+
+RouterLoader DeserializeLazy(std::istream& input, Base& base) {
+    const auto base_position = input.tellg();
+    proto::Base base_msg;
+    std::streamoff router_offset = 0;
+    {
+        google::protobuf::io::IstreamInputStream raw_input(&input);
+        google::protobuf::io::CodedInputStream coded_input(&raw_input);
+        uint64_t base_size = 0;
+        bool success = coded_input.ReadVarint64(&base_size);
+        const auto limit = coded_input.PushLimit(static_cast<int>(base_size));
+        success = success && base_msg.ParseFromCodedStream(&coded_input)
+                  && coded_input.ConsumedEntireMessage();
+        coded_input.PopLimit(limit);
+        assert(success);
+        if (!success)
+            return {};
+        // raw_input reads ahead, so position of router is counted by coded_input
+        router_offset = coded_input.CurrentPosition();
+    }
 
     assert(base_msg.has_transport_catalogue());
     auto [id_to_stop, id_to_bus] = Parse(base_msg.transport_catalogue(), base.transport_catalogue);
@@ -388,11 +632,23 @@ bool Deserialize(std::istream& input, Base& base) {
     assert(base_msg.has_routing_settings());
     Parse(base_msg.routing_settings(), base.routing_settings);
 
-    assert(base_msg.has_transport_router());
-    base.transport_router = Parse(base.transport_catalogue, base.routing_settings,
-                                  id_to_stop, id_to_bus, base_msg.transport_router());
-
-    return true;
+    auto id_maps = make_shared<pair<StopIdMap, BusIdMap>>(move(id_to_stop), move(id_to_bus));
+    return [&input, base, router_position = base_position + router_offset, id_maps]()
+           -> db::TransportRouter& {
+        if (!base.transport_router) {
+            input.clear();
+            input.seekg(router_position);
+            proto::TransportRouter transport_router_msg;
+            bool success = transport_router_msg.ParseFromIstream(&input);
+            assert(success);
+            if (!success)
+                throw runtime_error("failed to deserialize transport router");
+            base.transport_router = Parse(base.transport_catalogue, base.routing_settings,
+                                          id_maps->first, id_maps->second,
+                                          transport_router_msg);
+        }
+        return *base.transport_router;
+    };
 }
 
 } // tcat::io::serialization
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
 #include <memory>
 
@@ -22,6 +23,14 @@ struct Base {
 
 bool Serialize(const Base& base, std::ostream& output);
 
+// deserialize all, including transport router
 bool Deserialize(std::istream& input, Base& base);
 
+// Returns base.transport_router, it is deserialized on the first call.
+// Input stream must be alive and must not be read by others until then.
+using RouterLoader = std::function<db::TransportRouter&()>;
+
+// deserialize all but transport router, it's loaded by the returned function
+RouterLoader DeserializeLazy(std::istream& input, Base& base);
+
 } // tcat::io::serialization
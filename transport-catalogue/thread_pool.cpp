@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace parallel {
+
+using namespace std;
+
+size_t DefaultThreadCount() {
+    return max<size_t>(1, thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    for (size_t i = 1; i < thread_count; ++i) {
+        workers_.emplace_back([this] { WorkerThread(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    loop_started_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::ThreadCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::Run(size_t count, function<void(size_t)> func) {
+    lock_guard run_lock(run_mutex_);
+    Loop loop{count, move(func)};
+    {
+        lock_guard lock(mutex_);
+        assert(loop_ == nullptr);
+        loop_ = &loop;
+        ++generation_;
+    }
+    loop_started_.notify_all();
+
+    Execute(loop);
+
+    // all indices are taken, wait for workers still executing them
+    {
+        unique_lock lock(mutex_);
+        loop_finished_.wait(lock, [this] { return active_workers_ == 0; });
+        loop_ = nullptr;
+    }
+    if (loop.exception) {
+        rethrow_exception(loop.exception);
+    }
+}
+
+void ThreadPool::Execute(Loop& loop) {
+    try {
+        for (size_t i = loop.next++; i < loop.count; i = loop.next++) {
+            loop.func(i);
+        }
+    } catch (...) {
+        // skip the rest of indices, Run rethrows the exception after the loop
+        loop.next = loop.count;
+        lock_guard lock(mutex_);
+        if (!loop.exception) {
+            loop.exception = current_exception();
+        }
+    }
+}
+
+void ThreadPool::WorkerThread() {
+    size_t generation = 0;
+    while (true) {
+        Loop* loop = nullptr;
+        {
+            unique_lock lock(mutex_);
+            loop_started_.wait(lock, [&] { return stop_ || generation_ != generation; });
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+            loop = loop_;
+            if (loop == nullptr) {
+                continue; // woken up too late, loop is already finished
+            }
+            ++active_workers_;
+        }
+
+        Execute(*loop);
+
+        {
+            lock_guard lock(mutex_);
+            --active_workers_;
+        }
+        loop_finished_.notify_all();
+    }
+}
+
+} // namespace parallel
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// Number of threads (including caller's one) used by default
+size_t DefaultThreadCount();
+
+// Fixed-size pool of threads for parallel loops.
+// Caller thread takes part in every loop, so pool of N threads starts N-1 workers.
+// Loops started concurrently from different threads run one after another, so one pool
+// may be shared. Loop must not be started from inside a loop of the same pool.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = DefaultThreadCount());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    size_t ThreadCount() const;
+
+    // call func(i) for every i in [0, count) and wait for completion;
+    // if func throws, indices not taken yet are skipped and the first exception is rethrown
+    // when the loop is finished
+    template <typename Func>
+    void ParallelFor(size_t count, const Func& func) {
+        if (count == 0) {
+            return;
+        }
+        if (workers_.empty() || count == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+        Run(count, std::function<void(size_t)>(std::cref(func)));
+    }
+
+private:
+    struct Loop {
+        size_t count;
+        std::function<void(size_t)> func;
+        std::atomic<size_t> next{0}; // next index to execute
+        std::exception_ptr exception; // the first exception thrown by func, under mutex_
+    };
+
+    void Run(size_t count, std::function<void(size_t)> func);
+    void Execute(Loop& loop);
+    void WorkerThread();
+
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_; // held by the thread running a loop
+    std::mutex mutex_;
+    std::condition_variable loop_started_;
+    std::condition_variable loop_finished_;
+    Loop* loop_ = nullptr;
+    size_t generation_ = 0;   // number of started loops
+    size_t active_workers_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace parallel
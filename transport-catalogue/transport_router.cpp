@@ -1,216 +1,807 @@
-#include "transport_router.h"
-
-namespace tcat::db {
-
-using namespace std;
-
-// Simple forward-and-backward iterator
-// Iterate elements forward to the end by ordinary iterator
-// and then backward by reverse iterator
-// Primary usage for iterating over linear (non-round-trip) bus
-// Forward iterator requirements:
-// [input.iterators]:
-//   a != b
-//   *a
-//   a->m
-//   ++r
-// [forward.iterators]
-//   r++ -> const X&
-//
-// Iterator must be forward iterator
-template <typename Container,
-          typename Iterator,
-          typename T = enable_if_t<std::is_base_of_v<forward_iterator_tag,
-              typename std::iterator_traits<Iterator>::iterator_category>>>
-class ForwardAndBackIterator {
-
-public:
-
-    using iterator_type = Iterator;
-
-    using iterator_category = std::forward_iterator_tag;
-    using value_type = typename iterator_traits<iterator_type>::value_type;
-    using difference_type = typename iterator_traits<iterator_type>::difference_type;
-    using pointer = typename iterator_traits<iterator_type>::pointer;
-    using reference = typename iterator_traits<iterator_type>::reference;
-
-    using reverse_iterator = typename std::reverse_iterator<Iterator>;
-    using const_iterator = typename Container::const_iterator;
-
-    ForwardAndBackIterator(Container& cont, iterator_type iter)
-    : forward_(iter), rbegin_(cont.rbegin()), back_(cont.rbegin()) {}
-
-    ForwardAndBackIterator(Container& cont, reverse_iterator iter)
-    : forward_(cont.rbegin().base()), rbegin_(cont.rbegin()), back_(prev(iter)) {}
-
-    bool operator==(iterator_type i) const {
-        return back_ == rbegin_ && forward_ == i;
-    }
-
-    bool operator!=(iterator_type i) const {
-        return !(*this == i);
-    }
-
-    bool operator==(reverse_iterator i) const {
-        assert(i != rbegin_);
-        return forward_ == rbegin_.base() && next(back_) == i;
-    }
-
-    bool operator!=(reverse_iterator i) const {
-        return !(*this == i);
-    }
-
-    bool operator==(const ForwardAndBackIterator& other) const {
-        return forward_ == other.forward_ && rbegin_ == other.rbegin_ && back_ == other.back_;
-    }
-
-    bool operator!=(const ForwardAndBackIterator& other) const {
-        return !(*this == other);
-    }
-
-    reference operator*() const {
-        if (forward_ != rbegin_.base())
-            return *forward_;
-        else {
-            return *next(back_);
-        }
-    }
-
-    pointer operator->() const {
-        if (forward_ != rbegin_.base())
-            return forward_.operator->();
-        else {
-            return next(back_).operator->();
-        }
-    }
-
-    ForwardAndBackIterator& operator++() {
-        if (forward_ != rbegin_.base()) {
-            ++forward_;
-        } else {
-            ++back_;
-        }
-        return *this;
-    }
-
-    ForwardAndBackIterator operator++(int) {
-        auto temp = *this;
-        ++(*this);
-        return temp;
-    }
-
-private:
-    iterator_type forward_;         // points to current item during forward iterating
-    reverse_iterator rbegin_;       // rbegin().base() == end()
-    reverse_iterator back_;         // points to _previous_ item during backward iterating
-};
-
-TransportRouter::TransportRouter(const TransportCatalogue& tc, const RoutingSettings& settings)
-    : tcat_(tc), settings_(settings) {
-    InitializeGraph();
-    assert(graph_);
-    router_ = make_unique<Router>(*graph_);        
-}
-
-TransportRouter::TransportRouter(const TransportCatalogue& tc,
-                                 RoutingSettings&& settings,
-                                 std::unique_ptr<Graph>&& graph,
-                                 std::unique_ptr<Router>&& router,
-                                 StopVertices&& stop_vertices,
-                                 Edges&& edges) :
-    tcat_(tc),
-    settings_(move(settings)),
-    graph_(move(graph)),
-    router_(move(router)),
-    stop_vertices_(move(stop_vertices)),
-    edges_(move(edges)) {
-    // done!
-}
-
-optional<TransportRouter::RouteResult> TransportRouter::Route(const Stop* from, const Stop* to) {
-    assert(graph_);
-    assert(router_);
-    auto route = router_->BuildRoute(GetStopVertex(from),
-                                     GetStopVertex(to));
-    if (!route.has_value()) {
-        return nullopt;
-    }
-    RouteResult result;
-    result.total_time = route->weight;
-
-    for (const auto edge_id : route->edges) {
-        const EdgeData& edge_data = edges_[edge_id];
-        const Edge& edge = graph_->GetEdge(edge_id);
-
-        assert(edge_data.from != nullptr);
-        assert(edge_data.to != nullptr);
-        assert(edge_data.span > 0);
-        assert(edge_data.bus != nullptr);
-        assert(edge_data.wait > 0);
-        // edge is wait + bus activity
-        result.activities.push_back(WaitActivity{edge_data.from, edge_data.wait});
-        result.activities.push_back(BusActivity({edge_data.bus, edge_data.from,
-                                                 edge_data.span, edge.weight - edge_data.wait}));
-    }
-    return result;
-}
-
-void TransportRouter::InitializeGraph() {
-    const Weight bus_velocity = settings_.bus_velocity * 1000.0 / 60.0; // [meter/minute]
-    const Weight bus_wait_time = settings_.bus_wait_time;    // [minute]
-
-    // create stop vertices
-    graph::VertexId vertex_id = 0;
-    const auto [stops_begin, stops_end] = tcat_.StopsIterators();
-    for (auto stop_it = stops_begin; stop_it != stops_end; ++stop_it) {
-        stop_vertices_.insert({&*stop_it, vertex_id++});
-    }
-
-    // create graph
-    graph_ = make_unique<Graph>(stop_vertices_.size());
-
-    // add edges for buses
-    const auto [buses_begin, buses_end] = tcat_.BusesIterators();
-    for (auto bus_it = buses_begin; bus_it != buses_end; ++bus_it) {
-        InitializeGraphAddBus(&*bus_it, bus_wait_time, bus_velocity);
-    }
-}
-
-void TransportRouter::InitializeGraphAddBus(const Bus* bus, Weight bus_wait_time,
-Weight bus_velocity) {
-    const auto& stops = bus->Stops();
-    assert(stops.size() > 1);
-
-    assert(bus->Linear() || stops.back() == stops.front());
-
-    // use ForwardAndBackIterator to iterate forward and then backward
-    // over linear (non-round-trip) bus
-    ForwardAndBackIterator stops_begin(stops, stops.begin());
-    ForwardAndBackIterator stops_end =
-        bus->Linear() ? ForwardAndBackIterator(stops, prev(stops.rend()))
-                      : ForwardAndBackIterator(stops, prev(stops.end()));
-
-    // add edges between all stop pairs of the bus
-    for (auto from_it = stops_begin; from_it != stops_end; ++from_it) {
-        VertexId from_vertex = GetStopVertex(*from_it);
-        Distance distance = 0;
-        int span = 1;
-        for (auto to_it = from_it; to_it != stops_end; ++to_it) {
-            VertexId to_vertex = GetStopVertex(*next(to_it));
-            distance += tcat_.GetDistance(*to_it, *next(to_it));
-            // edge weight is time in minutes
-            auto transfer_edge_id = graph_->AddEdge({from_vertex,
-                                                     to_vertex,
-                                                     distance / bus_velocity + bus_wait_time});
-            assert(transfer_edge_id == edges_.size());
-            (void) transfer_edge_id; // remove warning: unused variable
-            edges_.push_back({bus_wait_time, *from_it, *to_it, span, bus});
-            ++span;
-        }
-    }
-}
-
-
-} // namespace tcat::db
-
-
+#include "transport_router.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace tcat::db {
+
+using namespace std;
+
+// Simple forward-and-backward iterator
+// Iterate elements forward to the end by ordinary iterator
+// and then backward by reverse iterator
+// Primary usage for iterating over linear (non-round-trip) bus
+// Forward iterator requirements:
+// [input.iterators]:
+//   a != b
+//   *a
+//   a->m
+//   ++r
+// [forward.iterators]
+//   r++ -> const X&
+//
+// Iterator must be forward iterator
+template <typename Container,
+          typename Iterator,
+          typename T = enable_if_t<std::is_base_of_v<forward_iterator_tag,
+              typename std::iterator_traits<Iterator>::iterator_category>>>
+class ForwardAndBackIterator {
+
+public:
+
+    using iterator_type = Iterator;
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename iterator_traits<iterator_type>::value_type;
+    using difference_type = typename iterator_traits<iterator_type>::difference_type;
+    using pointer = typename iterator_traits<iterator_type>::pointer;
+    using reference = typename iterator_traits<iterator_type>::reference;
+
+    using reverse_iterator = typename std::reverse_iterator<Iterator>;
+    using const_iterator = typename Container::const_iterator;
+
+    ForwardAndBackIterator(Container& cont, iterator_type iter)
+    : forward_(iter), rbegin_(cont.rbegin()), back_(cont.rbegin()) {}
+
+    ForwardAndBackIterator(Container& cont, reverse_iterator iter)
+    : forward_(cont.rbegin().base()), rbegin_(cont.rbegin()), back_(prev(iter)) {}
+
+    bool operator==(iterator_type i) const {
+        return back_ == rbegin_ && forward_ == i;
+    }
+
+    bool operator!=(iterator_type i) const {
+        return !(*this == i);
+    }
+
+    bool operator==(reverse_iterator i) const {
+        assert(i != rbegin_);
+        return forward_ == rbegin_.base() && next(back_) == i;
+    }
+
+    bool operator!=(reverse_iterator i) const {
+        return !(*this == i);
+    }
+
+    bool operator==(const ForwardAndBackIterator& other) const {
+        return forward_ == other.forward_ && rbegin_ == other.rbegin_ && back_ == other.back_;
+    }
+
+    bool operator!=(const ForwardAndBackIterator& other) const {
+        return !(*this == other);
+    }
+
+    reference operator*() const {
+        if (forward_ != rbegin_.base())
+            return *forward_;
+        else {
+            return *next(back_);
+        }
+    }
+
+    pointer operator->() const {
+        if (forward_ != rbegin_.base())
+            return forward_.operator->();
+        else {
+            return next(back_).operator->();
+        }
+    }
+
+    ForwardAndBackIterator& operator++() {
+        if (forward_ != rbegin_.base()) {
+            ++forward_;
+        } else {
+            ++back_;
+        }
+        return *this;
+    }
+
+    ForwardAndBackIterator operator++(int) {
+        auto temp = *this;
+        ++(*this);
+        return temp;
+    }
+
+private:
+    iterator_type forward_;         // points to current item during forward iterating
+    reverse_iterator rbegin_;       // rbegin().base() == end()
+    reverse_iterator back_;         // points to _previous_ item during backward iterating
+};
+
+TransportRouter::TransportRouter(const TransportCatalogue& tc, const RoutingSettings& settings)
+    : tcat_(tc), settings_(settings) {
+    InitializeGraph();
+    assert(graph_);
+    graph_->Freeze();
+    InitializeRouter();
+}
+
+TransportRouter::TransportRouter(const TransportCatalogue& tc,
+                                 RoutingSettings&& settings,
+                                 std::unique_ptr<Graph>&& graph,
+                                 std::unique_ptr<Router>&& router,
+                                 std::unique_ptr<ContractionHierarchy>&& contraction_hierarchy,
+                                 std::unique_ptr<Landmarks>&& landmarks,
+                                 std::unique_ptr<HubLabels>&& hub_labels,
+                                 StopVertices&& stop_vertices,
+                                 Edges&& edges) :
+    tcat_(tc),
+    settings_(move(settings)),
+    graph_(move(graph)),
+    router_(move(router)),
+    contraction_hierarchy_(move(contraction_hierarchy)),
+    landmarks_(move(landmarks)),
+    hub_labels_(move(hub_labels)),
+    stop_vertices_(move(stop_vertices)),
+    edges_(move(edges)) {
+    assert(graph_);
+    InitializeRouter();
+}
+
+size_t TransportRouter::StopPairHasher::operator()(const StopPair& stops) const noexcept {
+    std::hash<const void*> hasher;
+    return hasher(stops.first) + 47 * hasher(stops.second);
+}
+
+optional<TransportRouter::RouteResult> TransportRouter::Route(const Stop* from, const Stop* to) {
+    RouteResult result;
+    if (!Route(from, to, result)) {
+        return nullopt;
+    }
+    return result;
+}
+
+bool TransportRouter::Route(const Stop* from, const Stop* to, RouteResult& result) {
+    if (!route_cache_) {
+        return BuildRouteResult(from, to, result);
+    }
+    const StopPair stops{from, to};
+    if (auto cached = route_cache_->Get(stops)) {
+        if (!cached->has_value()) {
+            return false;
+        }
+        result = move(**cached);
+        return true;
+    }
+    const bool found = BuildRouteResult(from, to, result);
+    route_cache_->Put(stops, found ? optional<RouteResult>(result) : nullopt);
+    return found;
+}
+
+TransportRouter::RouteCacheStats TransportRouter::GetRouteCacheStats() const {
+    if (!route_cache_) {
+        return {};
+    }
+    return {route_cache_->Hits(), route_cache_->Misses()};
+}
+
+bool TransportRouter::BuildRouteResult(const Stop* from, const Stop* to,
+                                       RouteResult& result) const {
+    result.activities.clear();
+    if (raptor_router_) {
+        return RouteRaptor(from, to, result);
+    }
+    assert(graph_);
+    const VertexId from_vertex = GetStopVertex(from);
+    const VertexId to_vertex = GetStopVertex(to);
+
+    // activities are collected from the last edge and then reversed
+    optional<Weight> weight;
+    if (router_) {
+        // walk the table without intermediate vector of edges
+        weight = router_->VisitRouteBackward(from_vertex, to_vertex, [&](graph::EdgeId edge_id) {
+            AddActivitiesBackward(edge_id, result.activities);
+        });
+    } else if (auto route = BuildRoute(from_vertex, to_vertex)) {
+        FillRouteResult(*route, result);
+        return true;
+    }
+    if (!weight.has_value()) {
+        return false;
+    }
+    reverse(result.activities.begin(), result.activities.end());
+    result.total_time = *weight;
+    return true;
+}
+
+void TransportRouter::FillRouteResult(const Router::RouteInfo& route, RouteResult& result) const {
+    result.activities.clear();
+    for (auto it = route.edges.rbegin(); it != route.edges.rend(); ++it) {
+        AddActivitiesBackward(*it, result.activities);
+    }
+    reverse(result.activities.begin(), result.activities.end());
+    result.total_time = route.weight;
+}
+
+vector<optional<TransportRouter::RouteResult>>
+TransportRouter::RouteFrom(const Stop* from, const vector<const Stop*>& to) {
+    vector<optional<RouteResult>> result(to.size());
+    switch (settings_.router) {
+        case RouterType::DIJKSTRA:
+        case RouterType::BIDIRECTIONAL_DIJKSTRA:
+        case RouterType::ASTAR:
+        case RouterType::ALT:
+            break;
+        default:
+            // routes of precomputed routers don't share work
+            for (size_t index = 0; index < to.size(); ++index) {
+                result[index] = Route(from, to[index]);
+            }
+            return result;
+    }
+
+    // cached routes are taken from the cache, the rest are found by one search
+    vector<size_t> searched_indices;
+    vector<VertexId> targets;
+    for (size_t index = 0; index < to.size(); ++index) {
+        if (route_cache_) {
+            if (auto cached = route_cache_->Get({from, to[index]})) {
+                result[index] = move(*cached);
+                continue;
+            }
+        }
+        searched_indices.push_back(index);
+        targets.push_back(GetStopVertex(to[index]));
+    }
+    if (targets.empty()) {
+        return result;
+    }
+
+    assert(dijkstra_router_);
+    const auto routes = delta_stepping_router_
+                            ? delta_stepping_router_->BuildRoutes(GetStopVertex(from), targets)
+                            : dijkstra_router_->BuildRoutes(GetStopVertex(from), targets);
+    for (size_t i = 0; i < routes.size(); ++i) {
+        auto& route_result = result[searched_indices[i]];
+        if (routes[i]) {
+            route_result.emplace();
+            FillRouteResult(*routes[i], *route_result);
+        }
+        if (route_cache_) {
+            route_cache_->Put({from, to[searched_indices[i]]}, route_result);
+        }
+    }
+    return result;
+}
+
+void TransportRouter::AddActivitiesBackward(graph::EdgeId edge_id,
+                                            vector<Activity>& activities) const {
+    const EdgeData& edge_data = edges_[edge_id];
+    const Edge& edge = graph_->GetEdge(edge_id);
+
+    assert(edge_data.from != nullptr);
+    assert(edge_data.to != nullptr);
+    assert(edge_data.span >= 0);
+    assert(edge_data.bus != nullptr);
+    assert(edge_data.wait >= 0);
+    if (edge_data.span > 0) {
+        const double time = edge.weight - edge_data.wait;
+        // the next ride follows without wait if it is the last added activity
+        auto* next_ride = activities.empty() ? nullptr : get_if<BusActivity>(&activities.back());
+        if (next_ride && next_ride->bus == edge_data.bus) {
+            // the same bus goes on
+            next_ride->from = edge_data.from;
+            next_ride->span += edge_data.span;
+            next_ride->time += time;
+        } else {
+            activities.push_back(BusActivity({edge_data.bus, edge_data.from,
+                                              edge_data.span, time}));
+        }
+    }
+    if (edge_data.wait > 0) {
+        activities.push_back(WaitActivity{edge_data.from, edge_data.wait});
+    }
+}
+
+bool TransportRouter::RouteRaptor(const Stop* from, const Stop* to, RouteResult& result) const {
+    auto journey = raptor_router_->Route(from, to);
+    if (!journey.has_value()) {
+        return false;
+    }
+    result.total_time = journey->total_time;
+    for (const auto& leg : journey->legs) {
+        result.activities.push_back(WaitActivity{leg.from,
+                                                  static_cast<double>(settings_.bus_wait_time)});
+        result.activities.push_back(BusActivity({leg.bus, leg.from, leg.span, leg.ride_time}));
+    }
+    return true;
+}
+
+TransportRouter::TimeMatrix TransportRouter::RouteTimes(const vector<const Stop*>& from,
+                                                       const vector<const Stop*>& to) const {
+    TimeMatrix result;
+    result.reserve(from.size());
+    if (raptor_router_) {
+        for (const Stop* stop : from) {
+            result.push_back(raptor_router_->Times(stop, to));
+        }
+        return result;
+    }
+
+    vector<VertexId> sources;
+    sources.reserve(from.size());
+    for (const Stop* stop : from) {
+        sources.push_back(GetStopVertex(stop));
+    }
+    vector<VertexId> targets;
+    targets.reserve(to.size());
+    for (const Stop* stop : to) {
+        targets.push_back(GetStopVertex(stop));
+    }
+
+    // row-major matrix of weights
+    vector<optional<Weight>> weights;
+    switch (settings_.router) {
+        case RouterType::ALL_PAIRS:
+            assert(router_);
+            weights = router_->BuildWeights(sources, targets);
+            break;
+        case RouterType::CONTRACTION_HIERARCHIES:
+            assert(contraction_hierarchy_);
+            weights = contraction_hierarchy_->BuildWeights(sources, targets);
+            break;
+        case RouterType::HUB_LABELS:
+            assert(hub_labels_);
+            weights = hub_labels_->BuildWeights(sources, targets);
+            break;
+        case RouterType::DIJKSTRA:
+        case RouterType::BIDIRECTIONAL_DIJKSTRA:
+        case RouterType::ASTAR:
+        case RouterType::ALT:
+            // potentials direct search to one target, so plain one-to-many search is used
+            assert(dijkstra_router_);
+            weights = dijkstra_router_->BuildWeights(sources, targets);
+            break;
+        case RouterType::RAPTOR:
+            assert(false);
+            break;
+    }
+
+    for (size_t row = 0; row < sources.size(); ++row) {
+        result.emplace_back(weights.begin() + row * targets.size(),
+                            weights.begin() + (row + 1) * targets.size());
+    }
+    return result;
+}
+
+vector<TransportRouter::ReachableStop> TransportRouter::Reachable(const Stop* from,
+                                                                  double max_time) const {
+    vector<ReachableStop> result;
+    if (raptor_router_) {
+        for (const auto& [stop, time] : raptor_router_->Reachable(from, max_time)) {
+            result.push_back({stop, time});
+        }
+    } else {
+        const VertexId from_vertex = GetStopVertex(from);
+        const auto vertices =
+            router_                  ? router_->BuildReachable(from_vertex, max_time)
+            : delta_stepping_router_ ? delta_stepping_router_->BuildReachable(from_vertex, max_time)
+                                     : dijkstra_router_->BuildReachable(from_vertex, max_time);
+        for (const auto& [vertex, weight] : vertices) {
+            if (vertex_stops_[vertex]) {
+                result.push_back({vertex_stops_[vertex], weight});
+            }
+        }
+    }
+    sort(result.begin(), result.end(), [](const ReachableStop& lhs, const ReachableStop& rhs) {
+        return lhs.time < rhs.time
+               || (lhs.time == rhs.time && lhs.stop->Name() < rhs.stop->Name());
+    });
+    return result;
+}
+
+void TransportRouter::AddBus(const Bus* bus) {
+    assert(tcat_.GetBus(bus->Name()) == bus);
+    graph_->Thaw();
+    for (const Stop* stop : bus->Stops()) {
+        if (stop_vertices_.count(stop) == 0) {
+            stop_vertices_.insert({stop, graph_->AddVertex()});
+        }
+    }
+
+    const graph::EdgeId first_edge = graph_->GetEdgeCount();
+    if (settings_.router != RouterType::RAPTOR) {
+        vector<StopPairEdge> stop_pair_edges;
+        InitializeGraphAddBus(bus, settings_.bus_wait_time,
+                              settings_.bus_velocity * 1000.0 / 60.0, stop_pair_edges);
+        AddStopPairEdges(stop_pair_edges);
+    }
+    UpdateRouter(first_edge);
+}
+
+void TransportRouter::AddStops() {
+    vector<const Stop*> stops;
+    const auto [stops_begin, stops_end] = tcat_.StopsIterators();
+    for (auto stop_it = stops_begin; stop_it != stops_end; ++stop_it) {
+        if (stop_vertices_.count(&*stop_it) == 0) {
+            stops.push_back(&*stop_it);
+        }
+    }
+    if (stops.empty()) {
+        return;
+    }
+
+    graph_->Thaw();
+    for (const Stop* stop : stops) {
+        stop_vertices_.insert({stop, graph_->AddVertex()});
+    }
+    UpdateRouter(graph_->GetEdgeCount());
+}
+
+void TransportRouter::UpdateRouter(graph::EdgeId first_edge) {
+    if (router_) {
+        router_->AddEdges(first_edge, thread_pool_);
+    }
+    graph_->Freeze();
+
+    // everything but the all_pairs table is created again
+    contraction_hierarchy_.reset();
+    landmarks_.reset();
+    hub_labels_.reset();
+    InitializeRouter();
+}
+
+// create router of settings_.router type unless it is already deserialized
+void TransportRouter::InitializeRouter() {
+    if (settings_.route_cache_size > 0) {
+        route_cache_ = make_unique<RouteCache>(settings_.route_cache_size);
+    }
+
+    vertex_stops_.assign(graph_->GetVertexCount(), nullptr);
+    for (const auto& [stop, vertex] : stop_vertices_) {
+        vertex_stops_[vertex] = stop;
+    }
+
+    switch (settings_.router) {
+        case RouterType::ALL_PAIRS:
+            if (!router_) {
+                // O(n) edges per bus make searches from every vertex faster than cubic
+                // Floyd-Warshall, dense STOP_PAIRS graph suits Floyd-Warshall
+                router_ = make_unique<Router>(*graph_, thread_pool_,
+                                              settings_.graph_model == GraphModel::WAIT_AND_RIDE
+                                                  ? Router::BuildMethod::DIJKSTRA
+                                                  : Router::BuildMethod::FLOYD_WARSHALL);
+            }
+            break;
+        case RouterType::DIJKSTRA:
+        case RouterType::BIDIRECTIONAL_DIJKSTRA:
+            dijkstra_router_ = make_unique<DijkstraRouter>(*graph_, thread_pool_);
+            break;
+        case RouterType::CONTRACTION_HIERARCHIES:
+            if (!contraction_hierarchy_) {
+                contraction_hierarchy_ = make_unique<ContractionHierarchy>(*graph_);
+            }
+            // for bounded searches which don't suit the hierarchy
+            dijkstra_router_ = make_unique<DijkstraRouter>(*graph_, thread_pool_);
+            break;
+        case RouterType::ASTAR:
+            dijkstra_router_ = make_unique<DijkstraRouter>(*graph_, thread_pool_);
+            InitializeGeoLowerBound();
+            break;
+        case RouterType::ALT:
+            dijkstra_router_ = make_unique<DijkstraRouter>(*graph_, thread_pool_);
+            if (!landmarks_) {
+                // landmarks are stops, candidates are their vertices in order of ids
+                vector<VertexId> candidates;
+                candidates.reserve(stop_vertices_.size());
+                for (const auto& [stop, vertex] : stop_vertices_) {
+                    candidates.push_back(vertex);
+                }
+                sort(candidates.begin(), candidates.end());
+                landmarks_ = make_unique<Landmarks>(*graph_, settings_.landmark_count,
+                                                    candidates);
+            }
+            break;
+        case RouterType::HUB_LABELS:
+            if (!hub_labels_) {
+                hub_labels_ = make_unique<HubLabels>(*graph_);
+            }
+            // for bounded searches which don't suit labels
+            dijkstra_router_ = make_unique<DijkstraRouter>(*graph_, thread_pool_);
+            break;
+        case RouterType::RAPTOR:
+            raptor_router_ = make_unique<RaptorRouter>(tcat_, settings_.bus_wait_time,
+                                                       settings_.bus_velocity * 1000.0 / 60.0);
+            break;
+    }
+
+    const auto parallel_min_vertices = static_cast<size_t>(settings_.parallel_search_min_vertices);
+    if (dijkstra_router_ && graph_->GetVertexCount() >= parallel_min_vertices) {
+        delta_stepping_router_ = make_unique<DeltaSteppingRouter>(*graph_, thread_pool_);
+    } else {
+        delta_stepping_router_.reset();
+    }
+}
+
+void TransportRouter::InitializeGeoLowerBound() {
+    // stop vertices and ride vertices get coordinates of their stops
+    vertex_coordinates_.assign(graph_->GetVertexCount(), geo::Coordinates{0, 0});
+    for (const auto& [stop, vertex] : stop_vertices_) {
+        vertex_coordinates_[vertex] = stop->GetCoordinates();
+    }
+    assert(edges_.size() == graph_->GetEdgeCount());
+    for (graph::EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const Edge& edge = graph_->GetEdge(edge_id);
+        vertex_coordinates_[edge.from] = edges_[edge_id].from->GetCoordinates();
+        vertex_coordinates_[edge.to] = edges_[edge_id].to->GetCoordinates();
+    }
+
+    // Road distance in input data may be shorter than great-circle one, so the bound
+    // uses the least time per meter over all edges instead of bus velocity.
+    // Then time_per_meter_ * distance(u, target) <= weight(u, v) + time_per_meter_ *
+    // distance(v, target) for every edge and the potential is consistent.
+    time_per_meter_ = numeric_limits<Weight>::infinity();
+    for (const Edge& edge : ranges::AsRange(graph_->EdgesIterators())) {
+        const double distance = geo::ComputeDistance(vertex_coordinates_[edge.from],
+                                                     vertex_coordinates_[edge.to]);
+        if (distance > 0) {
+            time_per_meter_ = min(time_per_meter_, edge.weight / distance);
+        }
+    }
+    if (time_per_meter_ == numeric_limits<Weight>::infinity()) {
+        time_per_meter_ = 0;
+    }
+}
+
+template <typename Potential>
+optional<TransportRouter::Router::RouteInfo>
+TransportRouter::BuildRouteAStar(VertexId from, VertexId to, const Potential& potential) const {
+    assert(dijkstra_router_);
+    // potentials of reached vertices, -1 if not computed yet
+    vector<Weight> potentials(graph_->GetVertexCount(), -1);
+    return dijkstra_router_->BuildRoute(from, to, [&](VertexId vertex) {
+        Weight& vertex_potential = potentials[vertex];
+        if (vertex_potential < 0) {
+            vertex_potential = potential(vertex, to);
+        }
+        return vertex_potential;
+    });
+}
+
+optional<TransportRouter::Router::RouteInfo>
+TransportRouter::BuildRoute(VertexId from, VertexId to) const {
+    switch (settings_.router) {
+        case RouterType::ALL_PAIRS:
+            assert(router_);
+            return router_->BuildRoute(from, to);
+        case RouterType::DIJKSTRA:
+            assert(dijkstra_router_);
+            return dijkstra_router_->BuildRoute(from, to);
+        case RouterType::BIDIRECTIONAL_DIJKSTRA:
+            assert(dijkstra_router_);
+            return dijkstra_router_->BuildRouteBidirectional(from, to);
+        case RouterType::CONTRACTION_HIERARCHIES:
+            assert(contraction_hierarchy_);
+            return contraction_hierarchy_->BuildRoute(from, to);
+        case RouterType::HUB_LABELS:
+            assert(hub_labels_);
+            return hub_labels_->BuildRoute(from, to);
+        case RouterType::ASTAR: {
+            const geo::Coordinates target = vertex_coordinates_[to];
+            return BuildRouteAStar(from, to, [&](VertexId vertex, VertexId) {
+                return time_per_meter_ * geo::ComputeDistance(vertex_coordinates_[vertex], target);
+            });
+        }
+        case RouterType::ALT:
+            assert(landmarks_);
+            return BuildRouteAStar(from, to, [&](VertexId vertex, VertexId target) {
+                return landmarks_->Potential(vertex, target);
+            });
+        case RouterType::RAPTOR:
+            // routes are built by raptor_router_, graph has no edges
+            break;
+    }
+    assert(false);
+    return nullopt;
+}
+
+namespace {
+
+// position of cell (x, y) along Hilbert curve over 2^order * 2^order grid
+uint64_t HilbertIndex(uint32_t x, uint32_t y, int order) {
+    uint64_t index = 0;
+    for (uint32_t half = 1u << (order - 1); half > 0; half /= 2) {
+        const uint32_t rx = (x & half) ? 1 : 0;
+        const uint32_t ry = (y & half) ? 1 : 0;
+        index += static_cast<uint64_t>(half) * half * ((3 * rx) ^ ry);
+        // rotate the quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = half - 1 - (x & (half - 1));
+                y = half - 1 - (y & (half - 1));
+            }
+            swap(x, y);
+        }
+    }
+    return index;
+}
+
+// stable sort of stops along Hilbert curve over bounding box of their coordinates
+void SortByHilbertCurve(vector<const Stop*>& stops) {
+    if (stops.empty()) {
+        return;
+    }
+    constexpr int ORDER = 16;
+    constexpr double CELLS = (1u << ORDER) - 1;
+    double min_lat = stops.front()->GetCoordinates().lat;
+    double max_lat = min_lat;
+    double min_lng = stops.front()->GetCoordinates().lng;
+    double max_lng = min_lng;
+    for (const Stop* stop : stops) {
+        const geo::Coordinates coordinates = stop->GetCoordinates();
+        min_lat = min(min_lat, coordinates.lat);
+        max_lat = max(max_lat, coordinates.lat);
+        min_lng = min(min_lng, coordinates.lng);
+        max_lng = max(max_lng, coordinates.lng);
+    }
+    auto cell = [CELLS](double value, double min_value, double max_value) {
+        return max_value > min_value
+                   ? static_cast<uint32_t>((value - min_value) / (max_value - min_value) * CELLS)
+                   : 0u;
+    };
+
+    vector<pair<uint64_t, const Stop*>> indexed_stops;
+    indexed_stops.reserve(stops.size());
+    for (const Stop* stop : stops) {
+        const geo::Coordinates coordinates = stop->GetCoordinates();
+        indexed_stops.push_back({HilbertIndex(cell(coordinates.lng, min_lng, max_lng),
+                                              cell(coordinates.lat, min_lat, max_lat), ORDER),
+                                 stop});
+    }
+    stable_sort(indexed_stops.begin(), indexed_stops.end(),
+                [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    for (size_t index = 0; index < stops.size(); ++index) {
+        stops[index] = indexed_stops[index].second;
+    }
+}
+
+} // namespace
+
+void TransportRouter::InitializeGraph() {
+    const Weight bus_velocity = settings_.bus_velocity * 1000.0 / 60.0; // [meter/minute]
+    const Weight bus_wait_time = settings_.bus_wait_time;    // [minute]
+
+    // create stop vertices
+    vector<const Stop*> stops;
+    const auto [stops_begin, stops_end] = tcat_.StopsIterators();
+    for (auto stop_it = stops_begin; stop_it != stops_end; ++stop_it) {
+        stops.push_back(&*stop_it);
+    }
+    if (settings_.vertex_order == VertexOrder::HILBERT) {
+        SortByHilbertCurve(stops);
+    }
+    graph::VertexId vertex_id = 0;
+    for (const Stop* stop : stops) {
+        stop_vertices_.insert({stop, vertex_id++});
+    }
+
+    // create graph
+    graph_ = make_unique<Graph>(stop_vertices_.size());
+
+    // RAPTOR scans bus trips directly
+    if (settings_.router == RouterType::RAPTOR) {
+        return;
+    }
+
+    // add edges for buses
+    const auto [buses_begin, buses_end] = tcat_.BusesIterators();
+    vector<StopPairEdge> stop_pair_edges;
+    for (auto bus_it = buses_begin; bus_it != buses_end; ++bus_it) {
+        InitializeGraphAddBus(&*bus_it, bus_wait_time, bus_velocity, stop_pair_edges);
+    }
+    AddStopPairEdges(stop_pair_edges);
+}
+
+void TransportRouter::InitializeGraphAddBus(const Bus* bus, Weight bus_wait_time,
+Weight bus_velocity, vector<StopPairEdge>& stop_pair_edges) {
+    const auto& stops = bus->Stops();
+    assert(stops.size() > 1);
+
+    assert(bus->Linear() || stops.back() == stops.front());
+
+    // use ForwardAndBackIterator to iterate forward and then backward
+    // over linear (non-round-trip) bus
+    ForwardAndBackIterator stops_begin(stops, stops.begin());
+    ForwardAndBackIterator stops_end =
+        bus->Linear() ? ForwardAndBackIterator(stops, prev(stops.rend()))
+                      : ForwardAndBackIterator(stops, prev(stops.end()));
+
+    if (settings_.graph_model == GraphModel::WAIT_AND_RIDE) {
+        vector<const Stop*> trip(stops_begin, stops_end);
+        trip.push_back(*stops_end); // the last stop
+        InitializeGraphAddBusRides(bus, trip, bus_wait_time, bus_velocity);
+        return;
+    }
+
+    // edges between all stop pairs of the bus
+    for (auto from_it = stops_begin; from_it != stops_end; ++from_it) {
+        Distance distance = 0;
+        int span = 1;
+        for (auto to_it = from_it; to_it != stops_end; ++to_it) {
+            distance += tcat_.GetDistance(*to_it, *next(to_it));
+            // edge weight is time in minutes
+            stop_pair_edges.push_back({*next(to_it), distance / bus_velocity + bus_wait_time,
+                                       {bus_wait_time, *from_it, *to_it, span, bus}});
+            ++span;
+        }
+    }
+}
+
+void TransportRouter::AddStopPairEdges(const vector<StopPairEdge>& stop_pair_edges) {
+    // index of the first lightest edge between stops
+    unordered_map<StopPair, size_t, StopPairHasher> lightest_edges;
+    for (size_t index = 0; index < stop_pair_edges.size(); ++index) {
+        const StopPairEdge& edge = stop_pair_edges[index];
+        const StopPair stops{edge.data.from, edge.to};
+        auto [it, inserted] = lightest_edges.insert({stops, index});
+        if (!inserted && edge.weight < stop_pair_edges[it->second].weight) {
+            it->second = index;
+        }
+    }
+
+    const graph::EdgeId first_edge = graph_->GetEdgeCount();
+    for (size_t index = 0; index < stop_pair_edges.size(); ++index) {
+        const StopPairEdge& edge = stop_pair_edges[index];
+        if (lightest_edges.at({edge.data.from, edge.to}) != index) {
+            continue;
+        }
+        const VertexId from_vertex = GetStopVertex(edge.data.from);
+        const VertexId to_vertex = GetStopVertex(edge.to);
+        // edges of the graph added before aren't removed, the new edge is needed
+        // only if it is lighter than them; incident edges go in order of ids
+        bool dominated = false;
+        for (const graph::EdgeId edge_id : graph_->GetIncidentEdges(from_vertex)) {
+            if (edge_id >= first_edge) {
+                break;
+            }
+            const Edge& graph_edge = graph_->GetEdge(edge_id);
+            if (graph_edge.to == to_vertex && graph_edge.weight <= edge.weight) {
+                dominated = true;
+                break;
+            }
+        }
+        if (dominated) {
+            continue;
+        }
+        auto transfer_edge_id = graph_->AddEdge(from_vertex, to_vertex, edge.weight);
+        assert(transfer_edge_id == edges_.size());
+        (void) transfer_edge_id; // remove warning: unused variable
+        edges_.push_back(edge.data);
+    }
+}
+
+void TransportRouter::InitializeGraphAddBusRides(const Bus* bus, const vector<const Stop*>& trip,
+                                                 Weight bus_wait_time, Weight bus_velocity) {
+    assert(trip.size() > 1);
+
+    // ride vertex for every stop of the trip, they follow already existing vertices
+    const VertexId first_ride_vertex = graph_->GetVertexCount();
+    auto add_edge = [&](VertexId from, VertexId to, Weight weight, const EdgeData& edge_data) {
+        auto edge_id = graph_->AddEdge(from, to, weight);
+        assert(edge_id == edges_.size());
+        (void) edge_id; // remove warning: unused variable
+        edges_.push_back(edge_data);
+    };
+
+    for (size_t i = 0; i < trip.size(); ++i) {
+        const VertexId stop_vertex = GetStopVertex(trip[i]);
+        const VertexId ride_vertex = first_ride_vertex + i;
+        if (i + 1 < trip.size()) {
+            // wait for the bus and get on it
+            add_edge(stop_vertex, ride_vertex, bus_wait_time,
+                     {bus_wait_time, trip[i], trip[i], 0, bus});
+            // ride to the next stop
+            const Distance distance = tcat_.GetDistance(trip[i], trip[i + 1]);
+            add_edge(ride_vertex, ride_vertex + 1, distance / bus_velocity,
+                     {0, trip[i], trip[i + 1], 1, bus});
+        }
+        if (i > 0) {
+            // get off the bus
+            add_edge(ride_vertex, stop_vertex, 0, {0, trip[i], trip[i], 0, bus});
+        }
+    }
+}
+
+} // namespace tcat::db
+
+
@@ -1,94 +1,251 @@
-#pragma once
-
-#include "transport_catalogue.h"
-#include "graph.h"
-#include "router.h"
-
-#include <optional>
-#include <variant>
-#include <memory>
-
-namespace tcat::db {
-
-struct RoutingSettings {
-    int bus_wait_time = 6;
-    double bus_velocity = 60;
-};
-
-class TransportRouter {
-
-public:
-
-    using Weight = double;
-    using Edge = graph::Edge<Weight>;
-    using Graph = graph::DirectedWeightedGraph<Weight>;
-    using Router = graph::Router<Weight>;
-    using VertexId = graph::VertexId;
-
-    TransportRouter(const TransportCatalogue& tc, const RoutingSettings& settings);
-
-    struct WaitActivity {
-        const Stop* stop;
-        double time;
-    };
-
-    struct BusActivity {
-        const Bus* bus;
-        const Stop* from;
-        int span;
-        double time;
-    };
-
-    using Activity = std::variant<WaitActivity, BusActivity>;
-
-    struct RouteResult {
-        double total_time;
-        std::vector<Activity> activities;
-    };
-
-    std::optional<RouteResult> Route(const Stop* from, const Stop* to);
-
-    // internal types for serialization
-    using StopVertices = std::unordered_map<const Stop*, VertexId>;
-    struct EdgeData {
-        double wait;
-        const Stop* from;
-        const Stop* to;
-        int span;
-        const Bus* bus;
-    };
-    using Edges = std::vector<EdgeData>;
-
-    // accessors to internal fields
-    const auto& InternalGraph() const { return *graph_; }
-    const auto& InternalRouter() const { return *router_; }
-    const auto& InternalStopToVertex() const { return stop_vertices_; }
-    const auto& InternalEdges() const { return edges_; }
-
-    // constructor with internal fields
-    TransportRouter(const TransportCatalogue& tc, RoutingSettings&& settings,
-    std::unique_ptr<Graph>&& graph, std::unique_ptr<Router>&& router,
-    StopVertices&& stop_vertices, Edges&& edges);
-
-private:
-    const TransportCatalogue & tcat_;
-    const RoutingSettings settings_;
-
-    std::unique_ptr<Graph> graph_;
-    std::unique_ptr<Router> router_;
-
-    void InitializeGraph();
-    void InitializeGraphAddBus(const Bus* bus, Weight bus_wait_time, Weight bus_velocity);
-
-    StopVertices stop_vertices_;
-
-    inline graph::VertexId GetStopVertex(const Stop* stop) const {
-        auto it = stop_vertices_.find(stop);
-        assert(it != stop_vertices_.end());
-        return it->second;
-    }
-
-    Edges edges_;
-};
-
+#pragma once
+
+#include "transport_catalogue.h"
+#include "graph.h"
+#include "router.h"
+#include "dijkstra_router.h"
+#include "delta_stepping_router.h"
+#include "contraction_hierarchy.h"
+#include "landmarks.h"
+#include "hub_labels.h"
+#include "raptor_router.h"
+#include "thread_pool.h"
+#include "lru_cache.h"
+#include "geo.h"
+
+#include <cstdint>
+#include <optional>
+#include <variant>
+#include <memory>
+#include <vector>
+
+namespace tcat::db {
+
+enum class RouterType {
+    ALL_PAIRS,  // precomputed table of all routes, O(V^2) memory
+    DIJKSTRA,   // search on every request, no precomputed data
+    CONTRACTION_HIERARCHIES, // vertex order and shortcuts are precomputed
+    ASTAR,      // search directed to the target by geographic lower bound
+    ALT,        // search directed to the target by precomputed landmark weights, O(k*V) memory
+    BIDIRECTIONAL_DIJKSTRA, // search from both ends on every request, no precomputed data
+    RAPTOR,     // round-based scan of bus trips on every request, graph has no edges
+    HUB_LABELS, // precomputed labels of vertices, query merges two labels
+};
+
+enum class GraphModel {
+    STOP_PAIRS,     // stop vertices, edge for every pair of stops of a bus, O(n^2) per bus
+    WAIT_AND_RIDE,  // stop vertices and ride vertex for every stop of a bus, O(n) per bus
+};
+
+enum class VertexOrder {
+    STOPS,    // stop vertices in order of stops in the catalogue
+    HILBERT,  // stop vertices along Hilbert curve over stop coordinates, so close stops get
+              // close ids, rows of the route table and incidence lists
+};
+
+struct RoutingSettings {
+    int bus_wait_time = 6;
+    double bus_velocity = 60;
+    RouterType router = RouterType::ALL_PAIRS;
+    GraphModel graph_model = GraphModel::STOP_PAIRS;
+    int landmark_count = 8; // for ALT router
+    int route_cache_size = 0; // number of cached Route results, 0 disables the cache
+    VertexOrder vertex_order = VertexOrder::STOPS;
+    // one-to-all searches of search-based routers run in parallel on graphs of this number
+    // of vertices and more
+    int parallel_search_min_vertices = 20000;
+};
+
+class TransportRouter {
+
+public:
+
+    // Weights are minutes summed along routes, so they stay double to keep total times
+    // exact enough. Ids stored in the graph are 32-bit, graph throws std::length_error
+    // if the network doesn't fit.
+    using Weight = double;
+    using Index = uint32_t;
+    using Edge = graph::Edge<Weight, Index>;
+    using Graph = graph::DirectedWeightedGraph<Weight, Index>;
+    using Router = graph::Router<Weight, Index>;
+    using DijkstraRouter = graph::DijkstraRouter<Weight, Index>;
+    using DeltaSteppingRouter = graph::DeltaSteppingRouter<Weight, Index>;
+    using ContractionHierarchy = graph::ContractionHierarchy<Weight, Index>;
+    using Landmarks = graph::Landmarks<Weight, Index>;
+    using HubLabels = graph::HubLabels<Weight, Index>;
+    using VertexId = graph::VertexId;
+
+    TransportRouter(const TransportCatalogue& tc, const RoutingSettings& settings);
+
+    struct WaitActivity {
+        const Stop* stop;
+        double time;
+    };
+
+    struct BusActivity {
+        const Bus* bus;
+        const Stop* from;
+        int span;
+        double time;
+    };
+
+    using Activity = std::variant<WaitActivity, BusActivity>;
+
+    struct RouteResult {
+        double total_time;
+        std::vector<Activity> activities;
+    };
+
+    // results are cached if RoutingSettings::route_cache_size > 0, may be called concurrently
+    std::optional<RouteResult> Route(const Stop* from, const Stop* to);
+
+    // The same, but the route is written to result and its storage is reused.
+    // ALL_PAIRS routes are written directly into result, so without the cache there are
+    // no allocations once result.activities is large enough.
+    // Returns false if there is no route.
+    bool Route(const Stop* from, const Stop* to, RouteResult& result);
+
+    // routes from one stop to every stop of to in its order, nullopt if there is no route.
+    // Search-based routers run one search for all of them instead of one per route.
+    std::vector<std::optional<RouteResult>> RouteFrom(const Stop* from,
+                                                      const std::vector<const Stop*>& to);
+
+    struct RouteCacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    // zeros if the route cache is disabled
+    RouteCacheStats GetRouteCacheStats() const;
+
+    // total times of routes from every stop of from to every stop of to, nullopt if there is
+    // no route; routes themselves aren't built
+    using TimeMatrix = std::vector<std::vector<std::optional<double>>>;
+    TimeMatrix RouteTimes(const std::vector<const Stop*>& from,
+                          const std::vector<const Stop*>& to) const;
+
+    struct ReachableStop {
+        const Stop* stop;
+        double time;
+    };
+
+    // stops reachable from stop within max_time minutes in order of time,
+    // found by one search bounded by max_time or by scan of all_pairs table row
+    std::vector<ReachableStop> Reachable(const Stop* from, double max_time) const;
+
+    // Adds bus which is added to the catalogue after the router was built, stops without
+    // vertices get them. ALL_PAIRS table is updated by the new edges only, precomputed data
+    // of other routers is rebuilt. The route cache is cleared.
+    // Must not be called concurrently with other methods.
+    void AddBus(const Bus* bus);
+
+    // Gives vertices to stops which are added to the catalogue after the router was built,
+    // so stops without buses can be route ends too. Routers are updated as by AddBus.
+    // Must not be called concurrently with other methods.
+    void AddStops();
+
+    // internal types for serialization
+    using StopVertices = std::unordered_map<const Stop*, VertexId>;
+    // STOP_PAIRS edge is wait and ride over span stops.
+    // WAIT_AND_RIDE edge is either wait (span == 0, wait > 0), ride to the next stop
+    // (span == 1, wait == 0) or leaving the bus (span == 0, wait == 0).
+    struct EdgeData {
+        double wait;
+        const Stop* from;
+        const Stop* to;
+        int span;
+        const Bus* bus;
+    };
+    using Edges = std::vector<EdgeData>;
+
+    // accessors to internal fields
+    const auto& InternalGraph() const { return *graph_; }
+    const auto& InternalRouter() const { return router_; } // null if not ALL_PAIRS
+    // null if not CONTRACTION_HIERARCHIES
+    const auto& InternalContractionHierarchy() const { return contraction_hierarchy_; }
+    const auto& InternalLandmarks() const { return landmarks_; } // null if not ALT
+    const auto& InternalHubLabels() const { return hub_labels_; } // null if not HUB_LABELS
+    const auto& InternalStopToVertex() const { return stop_vertices_; }
+    const auto& InternalEdges() const { return edges_; }
+
+    // constructor with internal fields
+    TransportRouter(const TransportCatalogue& tc, RoutingSettings&& settings,
+    std::unique_ptr<Graph>&& graph, std::unique_ptr<Router>&& router,
+    std::unique_ptr<ContractionHierarchy>&& contraction_hierarchy,
+    std::unique_ptr<Landmarks>&& landmarks, std::unique_ptr<HubLabels>&& hub_labels,
+    StopVertices&& stop_vertices, Edges&& edges);
+
+private:
+    const TransportCatalogue & tcat_;
+    const RoutingSettings settings_;
+    // threads of parallel loops of routers, loops of concurrent calls run one after another
+    parallel::ThreadPool thread_pool_;
+
+    std::unique_ptr<Graph> graph_;
+    std::unique_ptr<Router> router_;
+    std::unique_ptr<DijkstraRouter> dijkstra_router_;
+    // one-to-all searches on graphs of settings_.parallel_search_min_vertices and more
+    // vertices, null if dijkstra_router_ is null
+    std::unique_ptr<DeltaSteppingRouter> delta_stepping_router_;
+    std::unique_ptr<ContractionHierarchy> contraction_hierarchy_;
+    std::unique_ptr<Landmarks> landmarks_;
+    std::unique_ptr<HubLabels> hub_labels_;
+    std::unique_ptr<RaptorRouter> raptor_router_;
+
+    void InitializeRouter();
+    // updates the all_pairs table by vertices and edges [first_edge, edge count) added to
+    // the thawed graph, freezes the graph and creates precomputed data of other routers again
+    void UpdateRouter(graph::EdgeId first_edge);
+    bool BuildRouteResult(const Stop* from, const Stop* to, RouteResult& result) const;
+    bool RouteRaptor(const Stop* from, const Stop* to, RouteResult& result) const;
+    void FillRouteResult(const Router::RouteInfo& route, RouteResult& result) const;
+    // adds activities of the edge to activities which are in reverse order
+    void AddActivitiesBackward(graph::EdgeId edge_id, std::vector<Activity>& activities) const;
+    void InitializeGeoLowerBound();
+    std::optional<Router::RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // A* search with potential(vertex, to) computed once per reached vertex
+    template <typename Potential>
+    std::optional<Router::RouteInfo> BuildRouteAStar(VertexId from, VertexId to,
+                                                     const Potential& potential) const;
+    void InitializeGraph();
+    // STOP_PAIRS edge candidate, only the lightest of parallel edges gets into the graph
+    struct StopPairEdge {
+        const Stop* to;
+        Weight weight;
+        EdgeData data;
+    };
+    // STOP_PAIRS edges are added to stop_pair_edges, WAIT_AND_RIDE edges to the graph
+    void InitializeGraphAddBus(const Bus* bus, Weight bus_wait_time, Weight bus_velocity,
+                               std::vector<StopPairEdge>& stop_pair_edges);
+    // adds edges which are lighter than other edges between the same stops, the first one
+    // of equal lightest edges is kept
+    void AddStopPairEdges(const std::vector<StopPairEdge>& stop_pair_edges);
+    void InitializeGraphAddBusRides(const Bus* bus, const std::vector<const Stop*>& trip,
+                                    Weight bus_wait_time, Weight bus_velocity);
+
+    StopVertices stop_vertices_;
+
+    inline graph::VertexId GetStopVertex(const Stop* stop) const {
+        auto it = stop_vertices_.find(stop);
+        assert(it != stop_vertices_.end());
+        return it->second;
+    }
+
+    Edges edges_;
+
+    using StopPair = std::pair<const Stop*, const Stop*>;
+    struct StopPairHasher {
+        size_t operator()(const StopPair& stops) const noexcept;
+    };
+    using RouteCache = cache::LruCache<StopPair, std::optional<RouteResult>, StopPairHasher>;
+    std::unique_ptr<RouteCache> route_cache_; // null if disabled
+
+    std::vector<const Stop*> vertex_stops_; // nullptr for not stop vertices
+
+    // A* data: stop coordinates of every vertex and the least route time per meter
+    // of great-circle distance
+    std::vector<geo::Coordinates> vertex_coordinates_;
+    Weight time_per_meter_ = 0;
+};
+
 } // namespace tcat::db
\ No newline at end of file